@@ -57,6 +57,31 @@
 
 // niters - On output, the number of iterations actually performed.
 
+// checkpoint - Optional.  If restart is set, resume from the latest
+//              complete checkpoint; if interval is positive, save the
+//              solver state every interval iterations.
+
+// trace - Optional.  If not 0, every timed call is recorded in it, by
+//         iteration (0 is the initial residual).
+
+// counters - Optional.  If not 0, hardware events are counted around
+//            every timed call.
+
+// HPCCG_refine - Same arguments, but solves by iterative refinement.
+//                Each step computes r = b - Ax with the double values
+//                (see residual_norm), solves A d = r with HPCCG (so with
+//                the float values if A has them) to refine_reduction
+//                times the residual, but not below tolerance, and sets
+//                x = x + d.  The float values limit how far one step
+//                can usefully go, but not the final residual.  Stops
+//                when the residual is at most tolerance, after max_iter
+//                CG iterations in all, or after max_refine_steps steps.
+//                niters counts the iterations of all steps, normr is the
+//                last double-precision residual and times are summed
+//                over the steps (times[6] is left alone).  nsteps is
+//                the number of corrections and residual_time the time
+//                spent computing residuals.
+
 /////////////////////////////////////////////////////////////////////////
 
 #include <iostream>
@@ -66,27 +91,37 @@ using std::endl;
 #include <cmath>
 #include "mytimer.hpp"
 #include "HPCCG.hpp"
+#include "tracked_memory.hpp"
+#include "hpccg_comm.hpp"
+#include "mixed_precision.hpp"
 
-#define TICK()  t0 = mytimer() // Use TICK and TOCK to time a code section
-#define TOCK(t) t += mytimer() - t0
+// Use TICK and TOCK to time a code section, TOCK also records it in the
+// trace and hardware counters.  Counters are read outside the timed part.
+#define TICK()  if (counters) counters_start(counters); t0 = mytimer(); t4_0 = t4
+#define TOCK(t, kernel) { double dt = mytimer() - t0; t += dt; \
+    if (counters) counters_stop(counters, kernel); \
+    if (trace) trace_record(trace, trace_iter, kernel, t0, dt, \
+			    (kernel)==TRACE_DDOT ? t4 - t4_0 : 0.0); }
 int HPCCG(HPC_Sparse_Matrix * A,
 	  const double * const b, double * const x,
 	  const int max_iter, const double tolerance, int &niters, double & normr,
-	  double * times)
+	  double * times, HPCCG_Checkpoint * checkpoint, HPCCG_Trace * trace,
+	  HPCCG_Counters * counters)
 
 {
   double t_begin = mytimer();  // Start timing right away
 
-  double t0 = 0.0, t1 = 0.0, t2 = 0.0, t3 = 0.0, t4 = 0.0;
+  double t0 = 0.0, t1 = 0.0, t2 = 0.0, t3 = 0.0, t4 = 0.0, t4_0 = 0.0;
+  int trace_iter = 0;
 #ifdef USING_MPI
-  double t5 = 0.0;
+  double t5 = 0.0, t5_wait = 0.0;
 #endif
   int nrow = A->local_nrow;
   int ncol = A->local_ncol;
 
-  double * r = new double [nrow];
-  double * p = new double [ncol]; // In parallel case, A is rectangular
-  double * Ap = new double [nrow];
+  double * r = tracked_new_vector(nrow);
+  double * p = tracked_new_vector(ncol); // In parallel case, A is rectangular
+  double * Ap = tracked_new_vector(nrow);
 
   normr = 0.0;
   double rtrans = 0.0;
@@ -94,7 +129,7 @@ int HPCCG(HPC_Sparse_Matrix * A,
 
 #ifdef USING_MPI
   int rank; // Number of MPI processes, My process ID
-  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_rank(hpccg_comm, &rank);
 #else
   int rank = 0; // Serial case (not using MPI)
 #endif
@@ -103,30 +138,57 @@ int HPCCG(HPC_Sparse_Matrix * A,
   if (print_freq>50) print_freq=50;
   if (print_freq<1)  print_freq=1;
 
-  // p is of length ncols, copy x to p for sparse MV operation
-  TICK(); waxpby(nrow, 1.0, x, 0.0, x, p); TOCK(t2);
+  // Checkpoints hold rtrans, t1..t5, the elapsed time and t5_wait
+  double scalars[checkpoint_num_scalars];
+  int k_start = 1;
+  if (checkpoint && checkpoint->restart)
+    {
+      int k_saved = checkpoint_restore(checkpoint, nrow, x, r, p, scalars);
+      if (k_saved>0)
+	{
+	  k_start = k_saved+1;
+	  niters = k_saved;
+	  rtrans = scalars[0];
+	  t1 = scalars[1]; t2 = scalars[2]; t3 = scalars[3]; t4 = scalars[4];
+#ifdef USING_MPI
+	  t5 = scalars[5];
+	  t5_wait = scalars[7];
+#endif
+	  t_begin -= scalars[6];
+	  normr = sqrt(rtrans);
+	  if (rank==0) cout << "Restarting from iteration " << k_saved
+			    << "   Residual = " << normr << endl;
+	}
+    }
+
+  if (k_start==1)
+    {
+      // p is of length ncols, copy x to p for sparse MV operation
+      TICK(); waxpby(nrow, 1.0, x, 0.0, x, p); TOCK(t2, TRACE_WAXPBY);
 #ifdef USING_MPI
-  TICK(); exchange_externals(A,p); TOCK(t5); 
+      TICK(); exchange_externals(A,p,t5_wait); TOCK(t5, TRACE_EXCHANGE); 
 #endif
-  TICK(); HPC_sparsemv(A, p, Ap); TOCK(t3);
-  TICK(); waxpby(nrow, 1.0, b, -1.0, Ap, r); TOCK(t2);
-  TICK(); ddot(nrow, r, r, &rtrans, t4); TOCK(t1);
-  normr = sqrt(rtrans);
+      TICK(); HPC_sparsemv(A, p, Ap); TOCK(t3, TRACE_SPARSEMV);
+      TICK(); waxpby(nrow, 1.0, b, -1.0, Ap, r); TOCK(t2, TRACE_WAXPBY);
+      TICK(); ddot(nrow, r, r, &rtrans, t4); TOCK(t1, TRACE_DDOT);
+      normr = sqrt(rtrans);
 
-  if (rank==0) cout << "Initial Residual = "<< normr << endl;
+      if (rank==0) cout << "Initial Residual = "<< normr << endl;
+    }
 
-  for(int k=1; k<max_iter && normr > tolerance; k++ )
+  for(int k=k_start; k<max_iter && normr > tolerance; k++ )
     {
+      trace_iter = k;
       if (k == 1)
 	{
-	  TICK(); waxpby(nrow, 1.0, r, 0.0, r, p); TOCK(t2);
+	  TICK(); waxpby(nrow, 1.0, r, 0.0, r, p); TOCK(t2, TRACE_WAXPBY);
 	}
       else
 	{
 	  oldrtrans = rtrans;
-	  TICK(); ddot (nrow, r, r, &rtrans, t4); TOCK(t1);// 2*nrow ops
+	  TICK(); ddot (nrow, r, r, &rtrans, t4); TOCK(t1, TRACE_DDOT);// 2*nrow ops
 	  double beta = rtrans/oldrtrans;
-	  TICK(); waxpby (nrow, 1.0, r, beta, p, p);  TOCK(t2);// 2*nrow ops
+	  TICK(); waxpby (nrow, 1.0, r, beta, p, p);  TOCK(t2, TRACE_WAXPBY);// 2*nrow ops
 	}
       normr = sqrt(rtrans);
       if (rank==0 && (k%print_freq == 0 || k+1 == max_iter))
@@ -134,16 +196,32 @@ int HPCCG(HPC_Sparse_Matrix * A,
      
 
 #ifdef USING_MPI
-      TICK(); exchange_externals(A,p); TOCK(t5); 
+      TICK(); exchange_externals(A,p,t5_wait); TOCK(t5, TRACE_EXCHANGE); 
 #endif
-      TICK(); HPC_sparsemv(A, p, Ap); TOCK(t3); // 2*nnz ops
+      TICK(); HPC_sparsemv(A, p, Ap); TOCK(t3, TRACE_SPARSEMV); // 2*nnz ops
       double alpha = 0.0;
-      TICK(); ddot(nrow, p, Ap, &alpha, t4); TOCK(t1); // 2*nrow ops
+      TICK(); ddot(nrow, p, Ap, &alpha, t4); TOCK(t1, TRACE_DDOT); // 2*nrow ops
       alpha = rtrans/alpha;
       TICK(); waxpby(nrow, 1.0, x, alpha, p, x);// 2*nrow ops
-      waxpby(nrow, 1.0, r, -alpha, Ap, r);  TOCK(t2);// 2*nrow ops
+      waxpby(nrow, 1.0, r, -alpha, Ap, r);  TOCK(t2, TRACE_WAXPBY);// 2*nrow ops
       niters = k;
+
+      if (checkpoint && checkpoint->interval>0 && k%checkpoint->interval==0)
+	{
+	  scalars[0] = rtrans;
+	  scalars[1] = t1; scalars[2] = t2; scalars[3] = t3; scalars[4] = t4;
+#ifdef USING_MPI
+	  scalars[5] = t5;
+	  scalars[7] = t5_wait;
+#else
+	  scalars[5] = 0.0;
+	  scalars[7] = 0.0;
+#endif
+	  scalars[6] = mytimer() - t_begin;
+	  checkpoint_save(checkpoint, nrow, k, x, r, p, scalars);
+	}
     }
+  if (checkpoint) checkpoint_finish(checkpoint);
 
   // Store times
   times[1] = t1; // ddot time
@@ -152,10 +230,63 @@ int HPCCG(HPC_Sparse_Matrix * A,
   times[4] = t4; // AllReduce time
 #ifdef USING_MPI
   times[5] = t5; // exchange boundary time
+  times[7] = t5_wait; // time waiting for boundary values to arrive
 #endif
-  delete [] p;
-  delete [] Ap;
-  delete [] r;
+  tracked_delete(p);
+  tracked_delete(Ap);
+  tracked_delete(r);
   times[0] = mytimer() - t_begin;  // Total time. All done...
   return(0);
 }
+
+int HPCCG_refine(HPC_Sparse_Matrix * A,
+		 const double * const b, double * const x,
+		 const int max_iter, const double tolerance, int & niters, double & normr,
+		 double * times, int & nsteps, double & residual_time,
+		 HPCCG_Counters * counters)
+{
+  double t_begin = mytimer();
+  const int nrow = A->local_nrow;
+  double * r = tracked_new_vector(nrow);
+  double * d = tracked_new_vector(nrow);
+
+#ifdef USING_MPI
+  int rank;
+  MPI_Comm_rank(hpccg_comm, &rank);
+#else
+  int rank = 0;
+#endif
+
+  for (int t=1; t<8; t++) if (t!=6) times[t] = 0.0;
+  double step_times[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+  niters = 0;
+  nsteps = 0;
+  residual_time = 0.0;
+  int ierr = 0;
+  while (true)
+    {
+      double t0 = mytimer();
+      normr = residual_norm(A, b, x, r);
+      residual_time += mytimer() - t0;
+      if (rank==0) cout << "Refinement step = " << nsteps << "   Residual = " << normr << endl;
+      if (normr<=tolerance || max_iter-niters<=1 || nsteps==max_refine_steps) break;
+
+      double inner_tolerance = normr*refine_reduction;
+      if (inner_tolerance<tolerance) inner_tolerance = tolerance;
+      for (int i=0; i<nrow; i++) d[i] = 0.0;
+      int step_iters = 0;
+      double step_normr = 0.0;
+      ierr = HPCCG(A, r, d, max_iter-niters, inner_tolerance, step_iters, step_normr,
+		   step_times, 0, 0, counters);
+      if (ierr) break;
+      niters += step_iters;
+      for (int t=1; t<8; t++) if (t!=6) times[t] += step_times[t];
+      waxpby(nrow, 1.0, x, 1.0, d, x);
+      nsteps++;
+    }
+
+  tracked_delete(d);
+  tracked_delete(r);
+  times[0] = mytimer() - t_begin;
+  return(ierr);
+}
@@ -46,6 +46,9 @@
 #include "ddot.hpp"
 #include "waxpby.hpp"
 #include "HPC_Sparse_Matrix.hpp"
+#include "checkpoint.hpp"
+#include "trace.hpp"
+#include "perf_counters.hpp"
 
 #ifdef USING_MPI
 #include "exchange_externals.hpp"
@@ -54,7 +57,18 @@
 #endif
 int HPCCG(HPC_Sparse_Matrix * A,
 	  const double * const b, double * const x,
-	  const int max_iter, const double tolerance, int & niters, double & normr, double * times);
+	  const int max_iter, const double tolerance, int & niters, double & normr, double * times,
+	  HPCCG_Checkpoint * checkpoint = 0, HPCCG_Trace * trace = 0,
+	  HPCCG_Counters * counters = 0);
+
+// Iterative refinement around HPCCG; see HPCCG.cpp
+const int max_refine_steps = 20;
+const double refine_reduction = 1.0e-6;
+int HPCCG_refine(HPC_Sparse_Matrix * A,
+		 const double * const b, double * const x,
+		 const int max_iter, const double tolerance, int & niters, double & normr,
+		 double * times, int & nsteps, double & residual_time,
+		 HPCCG_Counters * counters = 0);
 
 // this function will compute the Conjugate Gradient...
 // A <=> Matrix
@@ -69,4 +83,7 @@ int HPCCG(HPC_Sparse_Matrix * A,
 // b is known vector
 // xnot = 0
 // niters is the number of iterations
+// checkpoint <=> if not 0, periodically save state and/or resume from a saved state
+// trace <=> if not 0, record the time of every kernel call by iteration
+// counters <=> if not 0, count hardware events in every kernel call
 #endif
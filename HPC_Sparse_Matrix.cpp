@@ -39,12 +39,104 @@
 // 
 // ************************************************************************
 //@HEADER
+#include <cassert>
 #include "HPC_Sparse_Matrix.hpp"
+#include "tracked_memory.hpp"
 
 #ifdef USING_MPI
 #include <mpi.h>
 #endif
 
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+static void zeroRowCopies(HPC_Sparse_Matrix * A)
+{
+  A->list_of_float_vals = 0;
+  A->ptr_to_float_vals_in_row = 0;
+  A->list_of_short_inds = 0;
+  A->ptr_to_short_inds_in_row = 0;
+  A->list_of_val_codes = 0;
+  A->ptr_to_val_codes_in_row = 0;
+  A->val_table = 0;
+  A->val_table_size = 0;
+  A->block_size = 0;
+  A->block_row_start = 0;
+  A->list_of_block_cols = 0;
+  A->list_of_block_vals = 0;
+}
+
+static void zeroMatrixCopies(HPC_Sparse_Matrix * A)
+{
+  zeroRowCopies(A);
+  A->sym_diags = 0;
+  A->sym_row_start = 0;
+  A->list_of_sym_vals = 0;
+  A->list_of_sym_inds = 0;
+  A->sym_reach = 0;
+  A->sym_nblocks = 0;
+  A->sym_block_start = 0;
+  A->sym_buffer_start = 0;
+  A->sym_buffer = 0;
+  A->sym_buffer_size = 0;
+}
+
+void initMatrix(HPC_Sparse_Matrix * A)
+{
+  A->title = 0;
+  A->row_width = 0;
+  zeroMatrixCopies(A);
+}
+
+// Frees the copies HPC_sparsemv may use besides the rows and the upper
+// triangle
+static void destroyRowCopies(HPC_Sparse_Matrix * A)
+{
+  tracked_delete(A->list_of_float_vals);
+  tracked_delete(A->ptr_to_float_vals_in_row);
+  tracked_delete(A->list_of_short_inds);
+  tracked_delete(A->ptr_to_short_inds_in_row);
+  tracked_delete(A->list_of_val_codes);
+  tracked_delete(A->ptr_to_val_codes_in_row);
+  tracked_delete(A->val_table);
+  tracked_delete(A->block_row_start);
+  tracked_delete(A->list_of_block_cols);
+  tracked_delete(A->list_of_block_vals);
+  zeroRowCopies(A);
+}
+
+// Frees the copies HPC_sparsemv may use besides the rows
+static void destroyMatrixCopies(HPC_Sparse_Matrix * A)
+{
+  destroyRowCopies(A);
+  tracked_delete(A->sym_diags);
+  tracked_delete(A->sym_row_start);
+  tracked_delete(A->list_of_sym_vals);
+  tracked_delete(A->list_of_sym_inds);
+  tracked_delete(A->sym_reach);
+  tracked_delete(A->sym_block_start);
+  tracked_delete(A->sym_buffer_start);
+  tracked_delete(A->sym_buffer);
+  zeroMatrixCopies(A);
+}
+
+void destroyFullMatrix(HPC_Sparse_Matrix * A)
+{
+  assert(A->sym_row_start);
+  tracked_delete(A->list_of_vals);
+  tracked_delete(A->ptr_to_vals_in_row);
+  tracked_delete(A->list_of_inds);
+  tracked_delete(A->ptr_to_inds_in_row);
+  tracked_delete(A->ptr_to_diags);
+  A->list_of_vals = 0;
+  A->ptr_to_vals_in_row = 0;
+  A->list_of_inds = 0;
+  A->ptr_to_inds_in_row = 0;
+  A->ptr_to_diags = 0;
+  destroyRowCopies(A);
+}
+////////////////////////////////////////////////////////////////////////////////
+
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 void destroyMatrix(HPC_Sparse_Matrix * &A)
@@ -55,57 +147,58 @@ void destroyMatrix(HPC_Sparse_Matrix * &A)
   }
   if(A->nnz_in_row)
   {
-    delete [] A->nnz_in_row;
+    tracked_delete(A->nnz_in_row);
   }
   if(A->list_of_vals)
   {
-    delete [] A->list_of_vals;
+    tracked_delete(A->list_of_vals);
   }
   if(A->ptr_to_vals_in_row !=0)
   {
-    delete [] A->ptr_to_vals_in_row;
+    tracked_delete(A->ptr_to_vals_in_row);
   }
   if(A->list_of_inds)
   {
-    delete [] A->list_of_inds;
+    tracked_delete(A->list_of_inds);
   }
   if(A->ptr_to_inds_in_row !=0)
   {
-    delete [] A->ptr_to_inds_in_row;
+    tracked_delete(A->ptr_to_inds_in_row);
   }
   if(A->ptr_to_diags)
   {
-    delete [] A->ptr_to_diags;
+    tracked_delete(A->ptr_to_diags);
   }
+  destroyMatrixCopies(A);
 
 #ifdef USING_MPI
   if(A->external_index)
   {
-    delete [] A->external_index;
+    tracked_delete(A->external_index);
   }
   if(A->external_local_index)
   {
-    delete [] A->external_local_index;
+    tracked_delete(A->external_local_index);
   }
   if(A->elements_to_send)
   {
-    delete [] A->elements_to_send;
+    tracked_delete(A->elements_to_send);
   }
   if(A->neighbors)
   {
-    delete [] A->neighbors;
+    tracked_delete(A->neighbors);
   }
   if(A->recv_length)
   {
-    delete [] A->recv_length;
+    tracked_delete(A->recv_length);
   }
   if(A->send_length)
   {
-    delete [] A->send_length;
+    tracked_delete(A->send_length);
   }
   if(A->send_buffer)
   {
-    delete [] A->send_buffer;
+    tracked_delete(A->send_buffer);
   }
 #endif
 
@@ -155,38 +248,38 @@ void destroySharedMemMatrix(HPC_Sparse_Matrix * &A)
   // currently not allocated with shared memory
   if(A->ptr_to_diags)
   {
-    delete [] A->ptr_to_diags;
+    tracked_delete(A->ptr_to_diags);
   }
-
+  destroyMatrixCopies(A);
 
 #ifdef USING_MPI
   if(A->external_index)
   {
-    delete [] A->external_index;
+    tracked_delete(A->external_index);
   }
   if(A->external_local_index)
   {
-    delete [] A->external_local_index;
+    tracked_delete(A->external_local_index);
   }
   if(A->elements_to_send)
   {
-    delete [] A->elements_to_send;
+    tracked_delete(A->elements_to_send);
   }
   if(A->neighbors)
   {
-    delete [] A->neighbors;
+    tracked_delete(A->neighbors);
   }
   if(A->recv_length)
   {
-    delete [] A->recv_length;
+    tracked_delete(A->recv_length);
   }
   if(A->send_length)
   {
-    delete [] A->send_length;
+    tracked_delete(A->send_length);
   }
   if(A->send_buffer)
   {
-    delete [] A->send_buffer;
+    tracked_delete(A->send_buffer);
   }
 #endif
 
@@ -64,6 +64,7 @@ struct HPC_Sparse_Matrix_STRUCT {
   double ** ptr_to_vals_in_row;
   int ** ptr_to_inds_in_row;
   double ** ptr_to_diags;
+  int row_width;   // Nonzeros in most rows if HPC_sparsemv has a kernel for it, else 0 (see sparsemv_setup)
 
 #ifdef USING_MPI
   int num_external;
@@ -81,12 +82,65 @@ struct HPC_Sparse_Matrix_STRUCT {
   double *list_of_vals;   //needed for cleaning up memory
   int *list_of_inds;      //needed for cleaning up memory
 
+  // Single-precision copy of the values, which HPC_sparsemv uses if it
+  // exists (see make_float_values)
+  float *list_of_float_vals;
+  float ** ptr_to_float_vals_in_row;
+
+  // 16-bit column offsets from the row index, which HPC_sparsemv uses
+  // for the rows whose pointer is not 0 (see make_short_indices)
+  short *list_of_short_inds;
+  short ** ptr_to_short_inds_in_row;
+
+  // 1-byte codes into a table of the distinct values, which
+  // HPC_sparsemv uses if they exist (see make_value_codes)
+  unsigned char *list_of_val_codes;
+  unsigned char ** ptr_to_val_codes_in_row;
+  double *val_table;
+  int val_table_size;
+
+  // Upper triangle of a symmetric matrix, which HPC_sparsemv uses if it
+  // exists (see make_symmetric_matrix): the diagonal, and the entries of
+  // row i with a higher column at sym_row_start[i] to
+  // sym_row_start[i+1]-1.  sym_reach[i] is the highest local column of
+  // rows 0 to i.  The kernel splits the rows into sym_nblocks blocks,
+  // block b being rows sym_block_start[b] to sym_block_start[b+1]-1,
+  // whose buffer starts at sym_buffer[sym_buffer_start[b]].
+  double *sym_diags;
+  int *sym_row_start;
+  double *list_of_sym_vals;
+  int *list_of_sym_inds;
+  int *sym_reach;
+  int sym_nblocks;
+  int *sym_block_start;
+  long long *sym_buffer_start;
+  double *sym_buffer;
+  long long sym_buffer_size;
+
+  // Copy in dense block_size by block_size blocks, which HPC_sparsemv
+  // uses if it exists (see make_block_matrix): block row I has blocks
+  // block_row_start[I] to block_row_start[I+1]-1, each with its first
+  // column and its values row by row.
+  int block_size;
+  int *block_row_start;
+  int *list_of_block_cols;
+  double *list_of_block_vals;
+
 };
 typedef struct HPC_Sparse_Matrix_STRUCT HPC_Sparse_Matrix;
 
 
+// Sets title, row_width and every copy besides the rows to 0; call on
+// a new matrix before filling it
+void initMatrix(HPC_Sparse_Matrix * A);
+
 void destroyMatrix(HPC_Sparse_Matrix * &A);
 
+// Frees the rows and every copy besides the upper triangle, which
+// HPC_sparsemv then reads alone; nnz_in_row and the communication
+// data are kept
+void destroyFullMatrix(HPC_Sparse_Matrix * A);
+
 #ifdef USING_SHAREDMEM_MPI
 #ifndef SHAREDMEM_ALTERNATIVE
 void destroySharedMemMatrix(HPC_Sparse_Matrix * &A);
@@ -49,6 +49,9 @@
 // x - known vector
 // y - On exit contains Ax.
 
+// full_precision - If true, use the double values even if A has a
+//                  single-precision copy.
+
 /////////////////////////////////////////////////////////////////////////
 
 #include <iostream>
@@ -62,15 +65,34 @@ using std::endl;
 #include <string>
 #include <cmath>
 #include "HPC_sparsemv.hpp"
+#include "sparsemv_simd.hpp"
+#include "symmetric_matrix.hpp"
+#include "block_matrix.hpp"
 
 int HPC_sparsemv( HPC_Sparse_Matrix *A, 
-		 const double * const x, double * const y)
+		 const double * const x, double * const y,
+		 bool full_precision)
 {
 
+  // The upper triangle if A has one, which reads the fewest bytes
+  if (A->sym_row_start) return(sparsemv_symmetric(A, x, y));
+
+  // Dense blocks if A has them
+  if (A->block_row_start) return(sparsemv_block(A, x, y));
+
+  // Hand-vectorized, fixed-width, single-precision, coded-value or
+  // 16-bit index rows if any was selected.  The codes are exact, so
+  // they are used even for full precision.
+  bool float_vals = A->ptr_to_float_vals_in_row!=0 && !full_precision;
+  if (simd_isa!=SIMD_SCALAR || A->row_width || float_vals || A->ptr_to_val_codes_in_row
+      || A->ptr_to_short_inds_in_row)
+    return(sparsemv_simd(A, x, y, float_vals));
+
   const int nrow = (const int) A->local_nrow;
 
 #ifdef USING_OMP
-#pragma omp parallel for
+  // Schedule set by sparsemv_set_chunk
+#pragma omp parallel for schedule(runtime)
 #endif
   for (int i=0; i< nrow; i++)
     {
@@ -48,6 +48,9 @@
                  // then include mpi.h
 #endif
 
+// If A has single-precision values they are used, widened to double,
+// unless full_precision is set.
 int HPC_sparsemv( HPC_Sparse_Matrix *A, 
-		 const double * const x, double * const y);
+		 const double * const x, double * const y,
+		 bool full_precision = false);
 #endif
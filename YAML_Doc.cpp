@@ -5,11 +5,9 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
-#ifdef REDSTORM
 #include <time.h>
 #include <sys/stat.h>
 #include <sys/types.h>
-#endif
 #include "YAML_Doc.hpp"
 using namespace std;
 
@@ -30,13 +28,22 @@ YAML_Doc::~YAML_Doc(void){
 * to a file
 */
 string YAML_Doc::generateYAML(){
-  string yaml;
-  yaml =  yaml + "Mini-Application Name: " + miniAppName + "\n";
-  yaml =  yaml + "Mini-Application Version: " + miniAppVersion + "\n";
-  for(size_t i=0; i<children.size(); i++){
-    yaml = yaml + children[i]->printYAML("");
-  }
-  
+  ostringstream strm;
+  generate(strm, false);
+  return strm.str();
+}
+
+string YAML_Doc::generateJSON(){
+  ostringstream strm;
+  generate(strm, true);
+  return strm.str();
+}
+
+/*
+* writes the document to os and to a results file named by the
+* directory, file name, a timestamp and the format
+*/
+void YAML_Doc::generate(std::ostream& os, bool json){
   time_t rawtime;
   tm * ptm;
   time ( &rawtime );
@@ -51,24 +58,48 @@ string YAML_Doc::generateYAML(){
     filename = miniAppName + "-" + miniAppVersion + "_";
   else 
     filename = destinationFileName;
-  filename = filename + string(sdate) + ".yaml";
+  filename = filename + string(sdate) + (json ? ".json" : ".yaml");
   if (destinationDirectory!="" && destinationDirectory!=".") {
-    string mkdir_cmd = "mkdir " + destinationDirectory;
-#ifdef REDSTORM
-    mkdir(destinationDirectory.c_str(),0755);
-#else
-    system(mkdir_cmd.c_str());
-#endif
-    filename = destinationDirectory + "/" + destinationFileName;
+    mkdir(destinationDirectory.c_str(),0755); // Fails harmlessly if it exists
+    filename = destinationDirectory + "/" + filename;
   }
   else 
     filename = "./" + filename;
 
   ofstream myfile;
   myfile.open(filename.c_str());
-  myfile << yaml;
+  if (json) {
+    writeJSON(os);
+    writeJSON(myfile);
+  }
+  else {
+    writeYAML(os);
+    writeYAML(myfile);
+  }
   myfile.close();
-  return yaml;
 }
 
+void YAML_Doc::writeYAML(std::ostream& os){
+  os << "Mini-Application Name: " << miniAppName << "\n";
+  os << "Mini-Application Version: " << miniAppVersion << "\n";
+  for(size_t i=0; i<children.size(); i++){
+    children[i]->writeYAML(os, 0);
+  }
+}
 
+void YAML_Doc::writeJSON(std::ostream& os){
+  // Enough digits that every double reads back exactly
+  streamsize precision = os.precision(17);
+  os << "{\n  ";
+  writeJSONString(os, "Mini-Application Name");
+  os << ": ";
+  writeJSONString(os, miniAppName);
+  os << ",\n  ";
+  writeJSONString(os, "Mini-Application Version");
+  os << ": ";
+  writeJSONString(os, miniAppVersion);
+  os << (children.size()>0 ? ",\n" : "\n");
+  writeJSONMembers(os, 2);
+  os << "}\n";
+  os.precision(precision);
+}
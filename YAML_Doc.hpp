@@ -116,14 +116,24 @@ class YAML_Doc: public YAML_Element {
     \param destination_Directory (in, optional) path of diretory where results file will be stored, relative to current working directory. 
            If this value is not supplied, the results file will be stored in the current working directory.  If the directory does not exist
 	   it will be created.
-    \param destination_FileName (in, optional) root name of the results file.  A suffix of ".yaml" will be automatically appended.  If no
-           file name is specified the filename will be constructed by concatenating the miniAppName + miniAppVersion + ".yaml" strings.
+    \param destination_FileName (in, optional) root name of the results file.  A timestamp and a suffix of ".yaml" (or ".json") will be
+           automatically appended.  If no file name is specified the filename will be constructed by concatenating the miniAppName +
+           miniAppVersion + timestamp + ".yaml" strings.
   */
   YAML_Doc(const std::string& miniApp_Name, const std::string& miniApp_Version, const std::string& destination_Directory = "", const std::string& destination_FileName = "");
   //! Destructor
   ~YAML_Doc();
   //! Generate YAML results to standard out and to a file using specified directory and filename, using current directory and miniAppName + miniAppVersion + ".yaml" by default
   std::string generateYAML();
+  //! As generateYAML(), in JSON and to a ".json" file
+  std::string generateJSON();
+  //! Write the results as YAML, or JSON if json is true, to os and to the timestamped results file, without building a string
+  void generate(std::ostream& os, bool json = false);
+
+  //! Write the document as YAML
+  void writeYAML(std::ostream& os);
+  //! Write the document as one JSON object
+  void writeJSON(std::ostream& os);
 
 protected:
   std::string miniAppName;
@@ -2,11 +2,15 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <cstdio>
 #include "YAML_Element.hpp"
 using namespace std;
 YAML_Element::YAML_Element(const std::string& key_arg, const std::string& value_arg){
   key = key_arg;
   value = value_arg;
+  value_type = YAML_STRING;
+  int_value = 0;
+  double_value = 0.0;
 }
 
 YAML_Element::~YAML_Element(){
@@ -16,51 +20,58 @@ YAML_Element::~YAML_Element(){
   children.clear();
 }
 
+/*
+* Appends a child with no value.  An element with children has no
+* value of its own.
+*/
+YAML_Element* YAML_Element::addChild(const std::string& key_arg) {
+  this->value = "";
+  this->value_type = YAML_STRING;
+  YAML_Element* element = new YAML_Element(key_arg,"");
+  children.push_back(element);
+  return element;
+}
+
 /*
 * Add an element to the vector
 * QUESTION: if an element is not added because the key already exists,
 * will this lead to memory leakage?
 */
 YAML_Element* YAML_Element::add(const std::string& key_arg, double value_arg) {
-  this->value = "";
-  string converted_value = convert_double_to_string(value_arg);
-  YAML_Element* element = new YAML_Element(key_arg,converted_value);
-  children.push_back(element);
+  YAML_Element* element = addChild(key_arg);
+  element->value_type = YAML_DOUBLE;
+  element->double_value = value_arg;
   return element;
 }
 
 YAML_Element* YAML_Element::add(const std::string& key_arg, int value_arg) {
-  this->value = "";
-  string converted_value = convert_int_to_string(value_arg);
-  YAML_Element* element = new YAML_Element(key_arg,converted_value);
-  children.push_back(element);
+  YAML_Element* element = addChild(key_arg);
+  element->value_type = YAML_INT;
+  element->int_value = value_arg;
   return element;
 }
 
 #ifndef MINIFE_NO_LONG_LONG
 
 YAML_Element* YAML_Element::add(const std::string& key_arg, long long value_arg) {
-  this->value = "";
-  string converted_value = convert_long_long_to_string(value_arg);
-  YAML_Element* element = new YAML_Element(key_arg,converted_value);
-  children.push_back(element);
+  YAML_Element* element = addChild(key_arg);
+  element->value_type = YAML_INT;
+  element->int_value = value_arg;
   return element;
 }
 
 #endif
 
 YAML_Element* YAML_Element::add(const std::string& key_arg, size_t value_arg) {
-  this->value = "";
-  string converted_value = convert_size_t_to_string(value_arg);
-  YAML_Element* element = new YAML_Element(key_arg,converted_value);
-  children.push_back(element);
+  YAML_Element* element = addChild(key_arg);
+  element->value_type = YAML_SIZE_T;
+  element->int_value = (int_type) value_arg;
   return element;
 }
 
 YAML_Element* YAML_Element::add(const std::string& key_arg, const std::string& value_arg) {
-  this->value = "";
-  YAML_Element* element = new YAML_Element(key_arg, value_arg);
-  children.push_back(element);
+  YAML_Element* element = addChild(key_arg);
+  element->value = value_arg;
   return element;
 }
 
@@ -84,37 +95,77 @@ YAML_Element* YAML_Element::get(const std::string& key_arg) {
 * amount of space for the parent element
 */
 string YAML_Element::printYAML(std::string space){
-  string yaml_line = space + key + ": " + value + "\n";
-  for(int i=0; i<2; i++) space = space + " ";
+  ostringstream strm;
+  writeYAML(strm, (int) space.size());
+  return strm.str();
+}
+
+/*
+* writes the element and its children straight to the stream, so a
+* document costs time linear in its size
+*/
+void YAML_Element::writeYAML(std::ostream& os, int indent){
+  os << string(indent, ' ') << key << ": ";
+  writeValue(os);
+  os << "\n";
   for(size_t i=0; i<children.size(); i++){
-    yaml_line = yaml_line + children[i]->printYAML(space);
+    children[i]->writeYAML(os, indent+2);
   }
-  return yaml_line;
 }
 
-string YAML_Element::convert_double_to_string(double value_arg){
-  stringstream strm;
-  strm << value_arg;
-  return strm.str();
-}
-string YAML_Element::convert_int_to_string(int value_arg){
-  stringstream strm;
-  strm << value_arg;
-  return strm.str();
+/*
+* writes "key": value, or "key": { ... } if the element has children
+*/
+void YAML_Element::writeJSON(std::ostream& os, int indent){
+  os << string(indent, ' ');
+  writeJSONString(os, key);
+  os << ": ";
+  if (children.size()>0) {
+    os << "{\n";
+    writeJSONMembers(os, indent+2);
+    os << string(indent, ' ') << "}";
+  }
+  else if (value_type==YAML_STRING)
+    writeJSONString(os, value);
+  else if (value_type==YAML_DOUBLE && !(double_value==double_value &&
+	   double_value-double_value==0.0))
+    os << "null"; // JSON has no NaN or infinity
+  else
+    writeValue(os);
 }
 
-#ifndef MINIFE_NO_LONG_LONG
-
-string YAML_Element::convert_long_long_to_string(long long value_arg){
-  stringstream strm;
-  strm << value_arg;
-  return strm.str();
+void YAML_Element::writeJSONMembers(std::ostream& os, int indent){
+  for(size_t i=0; i<children.size(); i++){
+    children[i]->writeJSON(os, indent);
+    os << (i+1<children.size() ? ",\n" : "\n");
+  }
 }
 
-#endif
+void YAML_Element::writeJSONString(std::ostream& os, const std::string& text){
+  os << '"';
+  for (size_t i=0; i<text.size(); i++) {
+    unsigned char c = text[i];
+    if (c=='"' || c=='\\') os << '\\' << c;
+    else if (c=='\n') os << "\\n";
+    else if (c=='\t') os << "\\t";
+    else if (c<0x20) {
+      char escape[8];
+      sprintf(escape, "\\u%04x", c);
+      os << escape;
+    }
+    else os << c;
+  }
+  os << '"';
+}
 
-string YAML_Element::convert_size_t_to_string(size_t value_arg){
-  stringstream strm;
-  strm << value_arg;
-  return strm.str();
+/*
+* numbers are converted only here, with the stream's precision
+*/
+void YAML_Element::writeValue(std::ostream& os){
+  switch (value_type) {
+  case YAML_DOUBLE: os << double_value; break;
+  case YAML_INT:    os << int_value; break;
+  case YAML_SIZE_T: os << (size_t) int_value; break;
+  default:          os << value; break;
+  }
 }
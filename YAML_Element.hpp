@@ -50,17 +50,19 @@
 #define YAML_ELEMENT_H
 #include <string>
 #include <vector>
+#include <ostream>
 //! The Mantevo YAML_Element class for registering key-value pairs of performance data
 
 /*!
   Mantevo mini-applications generate a collection of performance data for each run of the executable.  YAML_Element, and
   the related YAML_Doc class, provide a uniform facility for gathering and reporting this data using the YAML text format.
+  Values keep their type until the document is printed, so they are written as numbers in JSON.
 */
 class YAML_Element {
   public:
 
   //! Default constructor.
-  YAML_Element (){key="";value="";}
+  YAML_Element (){key="";value="";value_type=YAML_STRING;int_value=0;double_value=0.0;}
   //! Construct with known key-value pair
   YAML_Element (const std::string& key_arg, const std::string& value_arg);
   //! Destructor
@@ -82,18 +84,32 @@ class YAML_Element {
   //! get the element in the list with the given key
   YAML_Element* get(const std::string& key_arg);
   std::string printYAML(std::string space);
-  
+  //! Write this element and its children as YAML, indented by indent spaces
+  void writeYAML(std::ostream& os, int indent);
+  //! Write this element as a JSON member (key and value or object), indented by indent spaces
+  void writeJSON(std::ostream& os, int indent);
+
 protected:
+#ifndef MINIFE_NO_LONG_LONG
+  typedef long long int_type;
+#else
+  typedef long int_type;
+#endif
+  enum { YAML_STRING, YAML_DOUBLE, YAML_INT, YAML_SIZE_T };
+
   std::string key;
-  std::string value;
+  std::string value;      // Value if value_type is YAML_STRING
+  int value_type;
+  int_type int_value;     // Value if value_type is YAML_INT or YAML_SIZE_T
+  double double_value;    // Value if value_type is YAML_DOUBLE
   std::vector<YAML_Element*> children;
 
+  YAML_Element* addChild(const std::string& key_arg);
+  //! Write the children as the members of a JSON object
+  void writeJSONMembers(std::ostream& os, int indent);
+  static void writeJSONString(std::ostream& os, const std::string& text);
+
 private:
-  std::string convert_double_to_string(double value_arg);
-  std::string convert_int_to_string(int value_arg);
-#ifndef MINIFE_NO_LONG_LONG
-  std::string convert_long_long_to_string(long long value_arg);
-#endif
-  std::string convert_size_t_to_string(size_t value_arg);
+  void writeValue(std::ostream& os);
 };
 #endif /* YAML_ELEMENT_H */
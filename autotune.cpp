@@ -0,0 +1,419 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Routine to choose how HPC_sparsemv runs on a matrix by timing it.
+
+// Which format is fastest depends on the matrix (stencil or
+// unstructured, dense blocks, distinct values, symmetry) and on the
+// node, so the candidates are timed on the matrix itself, once it is
+// final.  Only choices that give the same results, up to the order of
+// the sums, are tried: float values are left to float_values=1.
+
+// The search is greedy, to keep it to a few dozen timings:
+//   1. every instruction set with the double values or the value codes
+//      and the 32 or 16-bit indices, at the row width sparsemv_setup
+//      picked; the blocks with the generic and AVX2 kernels; and the
+//      upper triangle, as far as A has them (see make_value_codes,
+//      make_short_indices, make_block_matrix, make_symmetric_matrix)
+//   2. the best of these without the fixed row width
+//   3. with OpenMP, the best with dynamic schedules of 64 and 512 rows
+// Each candidate is timed over about 20 ms of calls after one warm-up
+// call; under MPI its time is the maximum over processors, so all make
+// the same choice.
+
+// The choice is cached in a text file, one line per key.  The key
+// names the host of processor 0, the number of processors and threads,
+// the best instruction set all processors support, and a hash of the
+// rows, columns and values of every processor's matrix.  Later runs
+// with the same key read the choice and only make the copies it needs.
+
+/////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+using std::cerr;
+using std::endl;
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#ifdef USING_MPI
+#include <mpi.h>
+#include "hpccg_comm.hpp"
+#endif
+#ifdef USING_OMP
+#include <omp.h>
+#endif
+#include "autotune.hpp"
+#include "HPC_sparsemv.hpp"
+#include "sparsemv_simd.hpp"
+#include "value_codes.hpp"
+#include "short_indices.hpp"
+#include "block_matrix.hpp"
+#include "symmetric_matrix.hpp"
+#include "mytimer.hpp"
+#include "tracked_memory.hpp"
+
+// Seconds of calls each candidate is timed over
+const double tune_seconds = 0.02;
+
+// Dynamic schedules tried, in rows per chunk
+const int tune_chunks[] = {64, 512};
+
+// A's copies while they are being tried, so the pointers HPC_sparsemv
+// checks can be switched on and off
+struct tune_copies {
+  unsigned char ** val_codes;
+  short ** short_inds;
+  int * block_row_start;
+  int * sym_row_start;
+};
+
+static inline unsigned long long mix(unsigned long long hash, unsigned long long word)
+{
+  return((hash ^ word)*0x100000001b3ULL); // FNV-1a, a word at a time
+}
+
+static unsigned long long matrix_signature(const HPC_Sparse_Matrix * A)
+{
+  unsigned long long hash = 0xcbf29ce484222325ULL;
+  hash = mix(hash, A->local_nrow);
+  hash = mix(hash, A->local_ncol);
+  for (int i=0; i<A->local_nrow; i++)
+    {
+      hash = mix(hash, A->nnz_in_row[i]);
+      for (int j=0; j<A->nnz_in_row[i]; j++)
+	{
+	  unsigned long long bits;
+	  memcpy(&bits, &A->ptr_to_vals_in_row[i][j], sizeof(bits));
+	  hash = mix(mix(hash, A->ptr_to_inds_in_row[i][j]), bits);
+	}
+    }
+#ifdef USING_MPI
+  int rank;
+  MPI_Comm_rank(hpccg_comm, &rank);
+  unsigned long long local_hash = mix(hash, rank), global_hash;
+  MPI_Allreduce(&local_hash, &global_hash, 1, MPI_UNSIGNED_LONG_LONG, MPI_BXOR, hpccg_comm);
+  hash = global_hash;
+#endif
+  return(hash);
+}
+
+static void describe(const SpMV_Choice & choice, int block_size, char * name)
+{
+  if (choice.symmetric) sprintf(name, "Symmetric");
+  else
+    {
+      sprintf(name, "%s", simd_isa_names[choice.isa]);
+      if (choice.blocks) sprintf(name+strlen(name), ", %dx%d blocks", block_size, block_size);
+      else
+	{
+	  if (choice.row_width) sprintf(name+strlen(name), ", row width %d", choice.row_width);
+	  if (choice.value_codes) strcat(name, ", value codes");
+	  if (choice.short_indices) strcat(name, ", 16-bit indices");
+	}
+    }
+  if (choice.chunk) sprintf(name+strlen(name), ", dynamic %d", choice.chunk);
+}
+
+static void apply(HPC_Sparse_Matrix * A, const SpMV_Choice & choice, const tune_copies & copies)
+{
+  simd_select_isa(choice.isa);
+  A->row_width = choice.row_width;
+  A->ptr_to_val_codes_in_row = choice.value_codes ? copies.val_codes : 0;
+  A->ptr_to_short_inds_in_row = choice.short_indices ? copies.short_inds : 0;
+  A->block_row_start = choice.blocks ? copies.block_row_start : 0;
+  A->sym_row_start = choice.symmetric ? copies.sym_row_start : 0;
+  sparsemv_set_chunk(choice.chunk);
+}
+
+// Average time of one call over ntrials calls, the max over processors
+static double time_choice(HPC_Sparse_Matrix * A, const SpMV_Choice & choice,
+			  const tune_copies & copies, int ntrials)
+{
+  apply(A, choice, copies);
+  double * p = tracked_new_vector(A->local_ncol);
+  double * Ap = tracked_new_vector(A->local_nrow);
+  for (int i=0; i<A->local_ncol; i++) p[i] = 1.0;
+  HPC_sparsemv(A, p, Ap); // Warm up
+  double t0 = mytimer();
+  for (int k=0; k<ntrials; k++) HPC_sparsemv(A, p, Ap);
+  double time = (mytimer() - t0)/ntrials;
+  tracked_delete(p);
+  tracked_delete(Ap);
+#ifdef USING_MPI
+  double local_time = time;
+  MPI_Allreduce(&local_time, &time, 1, MPI_DOUBLE, MPI_MAX, hpccg_comm);
+#endif
+  return(time);
+}
+
+// Frees the copies that choice does not read
+static void release(HPC_Sparse_Matrix * A, const SpMV_Choice & choice, const tune_copies & copies)
+{
+  if (!choice.value_codes)
+    {
+      tracked_delete(copies.val_codes);
+      tracked_delete(A->list_of_val_codes);
+      tracked_delete(A->val_table);
+      A->list_of_val_codes = 0;
+      A->val_table = 0;
+      A->val_table_size = 0;
+    }
+  if (!choice.short_indices)
+    {
+      tracked_delete(copies.short_inds);
+      tracked_delete(A->list_of_short_inds);
+      A->list_of_short_inds = 0;
+    }
+  if (!choice.blocks)
+    {
+      tracked_delete(copies.block_row_start);
+      tracked_delete(A->list_of_block_cols);
+      tracked_delete(A->list_of_block_vals);
+      A->list_of_block_cols = 0;
+      A->list_of_block_vals = 0;
+      A->block_size = 0;
+    }
+  if (!choice.symmetric)
+    {
+      tracked_delete(copies.sym_row_start);
+      tracked_delete(A->sym_diags);
+      tracked_delete(A->list_of_sym_vals);
+      tracked_delete(A->list_of_sym_inds);
+      tracked_delete(A->sym_reach);
+      tracked_delete(A->sym_block_start);
+      tracked_delete(A->sym_buffer_start);
+      tracked_delete(A->sym_buffer);
+      A->sym_diags = 0;
+      A->list_of_sym_vals = 0;
+      A->list_of_sym_inds = 0;
+      A->sym_reach = 0;
+      A->sym_nblocks = 0;
+      A->sym_block_start = 0;
+      A->sym_buffer_start = 0;
+      A->sym_buffer = 0;
+      A->sym_buffer_size = 0;
+    }
+}
+
+// Reads the last choice cached for key on processor 0 and sends it to
+// the others.  Returns whether one was found.
+static bool read_cache(const char * cache_file, const char * key, SpMV_Choice & choice)
+{
+  int found[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  int rank = 0;
+#ifdef USING_MPI
+  MPI_Comm_rank(hpccg_comm, &rank);
+#endif
+  FILE * in = rank==0 && cache_file ? fopen(cache_file, "r") : 0;
+  if (in)
+    {
+      char line[1024], line_key[256];
+      int c[7];
+      while (fgets(line, sizeof(line), in))
+	if (sscanf(line, "%255s isa=%d row_width=%d value_codes=%d short_indices=%d blocks=%d symmetric=%d chunk=%d",
+		   line_key, &c[0], &c[1], &c[2], &c[3], &c[4], &c[5], &c[6])==8
+	    && strcmp(line_key, key)==0)
+	  {
+	    found[0] = 1;
+	    for (int k=0; k<7; k++) found[k+1] = c[k];
+	  }
+      fclose(in);
+    }
+#ifdef USING_MPI
+  MPI_Bcast(found, 8, MPI_INT, 0, hpccg_comm);
+#endif
+  choice.isa = found[1];
+  choice.row_width = found[2];
+  choice.value_codes = found[3];
+  choice.short_indices = found[4];
+  choice.blocks = found[5];
+  choice.symmetric = found[6];
+  choice.chunk = found[7];
+  return(found[0]!=0);
+}
+
+static void write_cache(const char * cache_file, const char * key, const SpMV_Choice & choice)
+{
+  int rank = 0;
+#ifdef USING_MPI
+  MPI_Comm_rank(hpccg_comm, &rank);
+#endif
+  if (rank!=0 || cache_file==0) return;
+  FILE * out = fopen(cache_file, "a");
+  if (out==0)
+    {
+      cerr << "Warning: cannot write the tuning cache " << cache_file << endl;
+      return;
+    }
+  fprintf(out, "%s isa=%d row_width=%d value_codes=%d short_indices=%d blocks=%d symmetric=%d chunk=%d\n",
+	  key, choice.isa, choice.row_width, choice.value_codes, choice.short_indices,
+	  choice.blocks, choice.symmetric, choice.chunk);
+  fclose(out);
+}
+
+void tune_sparsemv(HPC_Sparse_Matrix * A, bool retune, const char * cache_file,
+		   HPCCG_Tuning & tuning)
+{
+  double t_start = mytimer();
+  int size = 1, threads = 1;
+#ifdef USING_MPI
+  MPI_Comm_size(hpccg_comm, &size);
+#endif
+#ifdef USING_OMP
+  threads = omp_get_max_threads();
+#endif
+  int best_isa = simd_detect_isa();
+#ifdef USING_MPI
+  int local_best_isa = best_isa;
+  MPI_Allreduce(&local_best_isa, &best_isa, 1, MPI_INT, MPI_MIN, hpccg_comm);
+#endif
+
+  char host[128] = "unknown";
+  gethostname(host, sizeof(host));
+  host[sizeof(host)-1] = 0;
+  snprintf(tuning.key, sizeof(tuning.key), "%s:np%d:t%d:%s:%016llx", host, size, threads,
+	   simd_isa_names[best_isa], matrix_signature(A));
+#ifdef USING_MPI
+  MPI_Bcast(tuning.key, sizeof(tuning.key), MPI_CHAR, 0, hpccg_comm);
+#endif
+
+  // What HPC_sparsemv runs without tuning
+  SpMV_Choice initial = {simd_isa, A->row_width, 0, 0, 0, 0, 0};
+  tune_copies copies = {0, 0, 0, 0};
+  double t = time_choice(A, initial, copies, 3);
+  int ntrials = t>0.0 ? (int) (tune_seconds/t) : 100;
+  if (ntrials<3) ntrials = 3;
+  if (ntrials>100) ntrials = 100;
+  tuning.default_time = time_choice(A, initial, copies, ntrials);
+  tuning.num_candidates = 0;
+
+  SpMV_Choice best = initial;
+  tuning.from_cache = !retune && read_cache(cache_file, tuning.key, best);
+  int have[4] = {1, 1, 1, 1}; // Copies to make: codes, 16-bit indices, blocks, triangle
+  if (tuning.from_cache)
+    {
+      have[0] = best.value_codes;
+      have[1] = best.short_indices;
+      have[2] = best.blocks;
+      have[3] = best.symmetric;
+    }
+  if (have[0]) make_value_codes(A);
+  if (have[1]) make_short_indices(A);
+  if (have[2]) make_block_matrix(A);
+  if (have[3]) make_symmetric_matrix(A);
+  copies.val_codes = A->ptr_to_val_codes_in_row;
+  copies.short_inds = A->ptr_to_short_inds_in_row;
+  copies.block_row_start = A->block_row_start;
+  copies.sym_row_start = A->sym_row_start;
+
+  if (!tuning.from_cache)
+    {
+      // Candidates that some processor has the copies for
+      have[0] = copies.val_codes!=0;
+      have[1] = copies.short_inds!=0;
+      have[2] = copies.block_row_start!=0;
+      have[3] = copies.sym_row_start!=0;
+#ifdef USING_MPI
+      int local_have[4] = {have[0], have[1], have[2], have[3]};
+      MPI_Allreduce(local_have, have, 4, MPI_INT, MPI_MAX, hpccg_comm);
+#endif
+      SpMV_Choice candidates[max_tune_candidates];
+      int n = 0;
+      for (int isa=SIMD_SCALAR; isa<=best_isa; isa++)
+	for (int codes=0; codes<=have[0]; codes++)
+	  for (int shorts=0; shorts<=have[1]; shorts++)
+	    {
+	      SpMV_Choice choice = {isa, initial.row_width, codes, shorts, 0, 0, 0};
+	      candidates[n++] = choice;
+	    }
+      for (int isa=SIMD_SCALAR; have[2] && isa<=best_isa; isa++)
+	if (isa==SIMD_SCALAR || isa==SIMD_AVX2)
+	  {
+	    SpMV_Choice choice = {isa, 0, 0, 0, 1, 0, 0};
+	    candidates[n++] = choice;
+	  }
+      if (have[3])
+	{
+	  SpMV_Choice choice = {SIMD_SCALAR, 0, 0, 0, 0, 1, 0};
+	  candidates[n++] = choice;
+	}
+
+      double best_time = 0.0;
+      for (int stage=1; stage<=3; stage++)
+	{
+	  if (stage==2 && !best.blocks && !best.symmetric && best.row_width)
+	    {
+	      candidates[n] = best;
+	      candidates[n++].row_width = 0;
+	    }
+#ifdef USING_OMP
+	  for (int k=0; stage==3 && !best.symmetric && threads>1 && k<(int) (sizeof(tune_chunks)/sizeof(int)); k++)
+	    {
+	      candidates[n] = best;
+	      candidates[n++].chunk = tune_chunks[k];
+	    }
+#endif
+	  for (int c=tuning.num_candidates; c<n; c++)
+	    {
+	      double time = time_choice(A, candidates[c], copies, ntrials);
+	      describe(candidates[c], A->block_size, tuning.candidate_names[c]);
+	      tuning.candidate_times[c] = time;
+	      if (c==0 || time<best_time)
+		{
+		  best = candidates[c];
+		  best_time = time;
+		}
+	    }
+	  tuning.num_candidates = n;
+	}
+      write_cache(cache_file, tuning.key, best);
+    }
+
+  apply(A, best, copies);
+  release(A, best, copies);
+  tuning.choice = best;
+  describe(best, A->block_size, tuning.choice_name);
+  tuning.choice_time = time_choice(A, best, copies, ntrials);
+  tuning.tuning_time = mytimer() - t_start;
+}
@@ -0,0 +1,83 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+#include "HPC_Sparse_Matrix.hpp"
+
+// A way of running HPC_sparsemv: instruction set, fixed row width,
+// which of A's copies it reads, and the OpenMP chunk (sparsemv_chunk)
+struct SpMV_Choice_STRUCT {
+  int isa;
+  int row_width;
+  int value_codes;
+  int short_indices;
+  int blocks;
+  int symmetric;
+  int chunk;
+};
+typedef struct SpMV_Choice_STRUCT SpMV_Choice;
+
+const int max_tune_candidates = 64;
+
+struct HPCCG_Tuning_STRUCT {
+  char key[256];       // Host, processors, threads, instruction set and matrix signature
+  int from_cache;      // Whether the choice was read from the cache file
+  SpMV_Choice choice;
+  char choice_name[80];
+  double default_time; // SPARSEMV time before tuning, and with the choice
+  double choice_time;
+  double tuning_time;  // Total time spent in tune_sparsemv
+  int num_candidates;  // Choices timed, 0 if read from the cache file
+  char candidate_names[max_tune_candidates][80];
+  double candidate_times[max_tune_candidates];
+};
+typedef struct HPCCG_Tuning_STRUCT HPCCG_Tuning;
+
+// Times HPC_sparsemv on A with the candidate choices, or reads the
+// choice for this matrix and host from cache_file unless retune is
+// set, and keeps the fastest: A then has only the copies it reads.
+// A newly timed choice is appended to cache_file if it is not 0.  Must
+// be called by all processors.
+void tune_sparsemv(HPC_Sparse_Matrix * A, bool retune, const char * cache_file,
+		   HPCCG_Tuning & tuning);
+#endif
@@ -0,0 +1,533 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+// Main routine of a program that times the HPCCG kernels one at a time,
+// outside of the solver.  The matrix is generated or read as in
+// test_HPCCG; HPC_sparsemv (with each instruction set the processor
+// supports, with double, float and coded values, and with 32 and
+// 16-bit indices, in dense blocks if it has them, and from the upper
+// triangle if it is symmetric) and the halo exchange are timed on it, and
+// ddot and waxpby on vectors of a range of lengths.  Under MPI, a
+// pairwise message exchange is also timed for a range of sizes.
+
+// Calling sequence:
+
+// bench_HPCCG nx ny nz [options]
+// bench_HPCCG HPC_data_file [options]
+
+// Options (name=value):
+
+// warmup=N - Untimed calls before each measurement (default 5)
+// reps=N - Timed repetitions of each measurement (default 50)
+// lengths=n1,n2,... - Vector lengths for ddot and waxpby
+// threads=t1,t2,... - OpenMP thread counts (default 1,2,4,... up to
+//                     the maximum)
+// messages=b1,b2,... - Message sizes in bytes (MPI only)
+
+// Each repetition times enough back-to-back calls to take about a
+// millisecond, and reports the time of one call.  Under MPI the time
+// of a repetition is the maximum over processors.  Results go to
+// standard output and a YAML file, with min, median, mean, max and
+// standard deviation for every measurement.
+
+/////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+using std::cout;
+using std::cerr;
+using std::endl;
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+#ifdef USING_MPI
+#include <mpi.h>
+#include "make_local_matrix.hpp"
+#include "exchange_externals.hpp"
+#endif
+#ifdef USING_OMP
+#include <omp.h>
+#endif
+#include "generate_matrix.hpp"
+#include "read_HPC_row.hpp"
+#include "read_matrix_market.hpp"
+#include "mytimer.hpp"
+#include "HPC_sparsemv.hpp"
+#include "sparsemv_simd.hpp"
+#include "mixed_precision.hpp"
+#include "short_indices.hpp"
+#include "value_codes.hpp"
+#include "symmetric_matrix.hpp"
+#include "block_matrix.hpp"
+#include "ddot.hpp"
+#include "waxpby.hpp"
+#include "roofline.hpp"
+#include "YAML_Element.hpp"
+#include "YAML_Doc.hpp"
+#include "parse_options.hpp"
+
+static std::vector<int> parse_list(const char * value)
+{
+  std::vector<int> list;
+  while (*value)
+    {
+      list.push_back(atoi(value));
+      while (*value && *value!=',') value++;
+      if (*value==',') value++;
+    }
+  return(list);
+}
+
+// Number of back-to-back calls per repetition for a kernel that takes
+// roughly work nanoseconds.
+static int calls_per_rep(double work)
+{
+  int calls = (int) (1.0e6/(work+1.0));
+  return(calls<1 ? 1 : calls);
+}
+
+// Adds min/median/mean/max/stddev of the per-call times to element.
+// Returns the median.
+static double add_statistics(YAML_Element * element, std::vector<double> & times)
+{
+#ifdef USING_MPI
+  std::vector<double> local_times(times);
+  MPI_Allreduce(&local_times[0], &times[0], times.size(), MPI_DOUBLE, MPI_MAX,
+		MPI_COMM_WORLD);
+#endif
+  int n = times.size();
+  double mean = 0.0, var = 0.0;
+  for (int i=0; i<n; i++) mean += times[i];
+  mean /= n;
+  for (int i=0; i<n; i++) var += (times[i]-mean)*(times[i]-mean);
+  std::sort(times.begin(), times.end());
+  double median = (n%2) ? times[n/2] : 0.5*(times[n/2-1]+times[n/2]);
+  element->add("Min",times[0]);
+  element->add("Median",median);
+  element->add("Mean",mean);
+  element->add("Max",times[n-1]);
+  element->add("Stddev",n>1 ? sqrt(var/(n-1)) : 0.0);
+  return(median);
+}
+
+int main(int argc, char *argv[])
+{
+  HPC_Sparse_Matrix *A;
+  double *x, *b, *xexact;
+
+#ifdef USING_MPI
+  MPI_Init(&argc, &argv);
+  int size, rank; // Number of MPI processes, My process ID
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+#else
+  int size = 1; // Serial case (not using MPI)
+  int rank = 0;
+#endif
+
+  int warmup = 5, reps = 50;
+  bool json = false;
+  std::vector<int> lengths, threads, messages;
+  int lengths_default[] = {1000, 10000, 100000, 1000000, 4000000};
+  lengths.assign(lengths_default, lengths_default+5);
+  int messages_default[] = {8, 64, 512, 4096, 32768, 262144, 2097152};
+  messages.assign(messages_default, messages_default+7);
+  int max_threads = 1;
+#ifdef USING_OMP
+  max_threads = omp_get_max_threads();
+#endif
+  for (int t=1; t<max_threads; t*=2) threads.push_back(t);
+  threads.push_back(max_threads);
+
+  int nargs = count_positional(argc, argv);
+  bool bad_option = false;
+  for (int i=nargs+1; i<argc; i++)
+    {
+      const char * value;
+      if ((value = option_value(argv[i], "warmup"))) warmup = atoi(value);
+      else if ((value = option_value(argv[i], "reps"))) reps = atoi(value);
+      else if ((value = option_value(argv[i], "lengths"))) lengths = parse_list(value);
+      else if ((value = option_value(argv[i], "threads"))) threads = parse_list(value);
+      else if ((value = option_value(argv[i], "messages"))) messages = parse_list(value);
+      else if ((value = option_value(argv[i], "output_format")) && strcmp(value,"yaml")==0) json = false;
+      else if ((value = option_value(argv[i], "output_format")) && strcmp(value,"json")==0) json = true;
+      else bad_option = true;
+    }
+  if ((nargs!=1 && nargs!=3) || bad_option || reps<1 || lengths.empty() || threads.empty())
+    {
+      if (rank==0)
+	cerr << "Usage:" << endl
+	     << "     " << argv[0] << " nx ny nz [options]" << endl
+	     << "     " << argv[0] << " HPC_data_file [options]" << endl
+	     << "Options (name=value):" << endl
+	     << "     warmup=N  Untimed calls before each measurement (default 5)" << endl
+	     << "     reps=N  Timed repetitions of each measurement (default 50)" << endl
+	     << "     lengths=n1,n2,...  Vector lengths for DDOT and WAXPBY" << endl
+	     << "     threads=t1,t2,...  OpenMP thread counts" << endl
+	     << "     messages=b1,b2,...  Message sizes in bytes (MPI only)" << endl
+	     << "     output_format=yaml|json  Format of the report (default yaml)" << endl;
+#ifdef USING_MPI
+      MPI_Finalize();
+#endif
+      exit(1);
+    }
+
+  int nx = 0, ny = 0, nz = 0;
+  if (nargs==3)
+    {
+      nx = atoi(argv[1]);
+      ny = atoi(argv[2]);
+      nz = atoi(argv[3]);
+      generate_matrix(nx, ny, nz, &A, &x, &b, &xexact);
+    }
+  else
+    {
+      size_t len = strlen(argv[1]);
+      if (len>4 && strcmp(argv[1]+len-4, ".mtx")==0)
+	read_matrix_market(argv[1], &A, &x, &b, &xexact);
+      else
+	read_HPC_row(argv[1], &A, &x, &b, &xexact);
+    }
+#ifdef USING_MPI
+  make_local_matrix(A);
+#endif
+  sparsemv_setup(A);
+
+  double bytes_ddot, bytes_waxpby, bytes_sparsemv;
+  min_traffic(A, bytes_ddot, bytes_waxpby, bytes_sparsemv);
+  long long local_nnz = 0, total_nnz = 0;
+  for (int i=0; i<A->local_nrow; i++) local_nnz += A->nnz_in_row[i];
+#ifdef USING_MPI
+  MPI_Allreduce(&local_nnz, &total_nnz, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+#else
+  total_nnz = local_nnz;
+#endif
+  // The float copy of the values, read unless full precision is asked
+  // for, and the value codes and 16-bit indices, read while A points
+  // to them.  Each saves bytes on the nonzeros it covers.
+  make_float_values(A);
+  make_value_codes(A);
+  make_short_indices(A);
+  unsigned char ** val_codes = A->ptr_to_val_codes_in_row;
+  short ** short_inds = A->ptr_to_short_inds_in_row;
+  A->ptr_to_val_codes_in_row = 0;
+  // Every processor must have codes for the kernels to be compared
+  int have_codes = val_codes!=0;
+  long long local_counts[2] = {0, 0}, counts[2]; // Nonzeros with codes, with 16-bit indices
+  if (val_codes) local_counts[0] = local_nnz;
+  for (int i=0; i<A->local_nrow; i++)
+    if (short_inds && short_inds[i]) local_counts[1] += A->nnz_in_row[i];
+#ifdef USING_MPI
+  MPI_Allreduce(local_counts, counts, 2, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+  int local_have_codes = have_codes;
+  MPI_Allreduce(&local_have_codes, &have_codes, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+#else
+  counts[0] = local_counts[0];
+  counts[1] = local_counts[1];
+#endif
+  double float_saving = (sizeof(double)-sizeof(float))*(double) total_nnz;
+  double code_saving = (sizeof(double)-1.0)*(double) counts[0];
+  double short_saving = (sizeof(int)-sizeof(short))*(double) counts[1];
+
+  // The dense blocks, read while A points to them, if every processor
+  // has them
+  int block_size = make_block_matrix(A), have_blocks = block_size;
+#ifdef USING_MPI
+  int local_have_blocks = have_blocks;
+  MPI_Allreduce(&local_have_blocks, &have_blocks, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+#endif
+  int * block_row_start = A->block_row_start;
+  double bytes_blocks = 0.0, ddot_unused, waxpby_unused;
+  if (have_blocks) min_traffic(A, ddot_unused, waxpby_unused, bytes_blocks);
+  A->block_row_start = 0;
+
+  // The upper triangle, read while A points to it, if every processor
+  // has a symmetric matrix
+  int have_sym = make_symmetric_matrix(A);
+#ifdef USING_MPI
+  int local_have_sym = have_sym;
+  MPI_Allreduce(&local_have_sym, &have_sym, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+#endif
+  int * sym_row_start = A->sym_row_start;
+  double bytes_symmetric = 0.0;
+  if (have_sym) min_traffic(A, ddot_unused, waxpby_unused, bytes_symmetric);
+  A->sym_row_start = 0;
+
+  YAML_Doc doc("hpccg_bench", "1.0");
+  doc.add("Parallelism","");
+  doc.get("Parallelism")->add("Number of MPI ranks",size);
+  doc.get("Parallelism")->add("Max OpenMP threads",max_threads);
+  doc.add("Timer","");
+  doc.get("Timer")->add("Backend",mytimer_name());
+  doc.get("Timer")->add("Resolution",mytimer_resolution());
+  doc.add("Matrix","");
+  doc.get("Matrix")->add("Rows",A->total_nrow);
+  doc.get("Matrix")->add("Nonzeros",total_nnz);
+  doc.add("Warmup calls",warmup);
+  doc.add("Repetitions",reps);
+  doc.add("#********** Times are per call, in sec ***********","");
+  // The ISAs of all processors must match for the timings to line up
+  int best_isa = simd_detect_isa();
+#ifdef USING_MPI
+  int min_isa;
+  MPI_Allreduce(&best_isa, &min_isa, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+  best_isa = min_isa;
+#endif
+  int row_width = A->row_width;
+  YAML_Element * spmv_doc = doc.add("SPARSEMV","");
+  YAML_Element * ddot_doc = doc.add("DDOT","");
+  YAML_Element * waxpby_doc = doc.add("WAXPBY","");
+
+  int max_length = *std::max_element(lengths.begin(), lengths.end());
+  if (max_length<A->local_ncol) max_length = A->local_ncol;
+  double * v1 = new double[max_length];
+  double * v2 = new double[max_length];
+  double * v3 = new double[max_length];
+  std::vector<double> times(reps);
+  char key[64];
+
+  for (size_t it=0; it<threads.size(); it++)
+    {
+#ifdef USING_OMP
+      omp_set_num_threads(threads[it]);
+#else
+      if (threads[it]!=1) continue;
+#endif
+      // Touch the vectors with this thread team, as the solver would
+#ifdef USING_OMP
+#pragma omp parallel for
+#endif
+      for (int i=0; i<max_length; i++)
+	{
+	  v1[i] = 1.0;
+	  v2[i] = 1.0/(i+1);
+	  v3[i] = 0.0;
+	}
+      sprintf(key, "Threads %d", threads[it]);
+
+      // Sparse matrix-vector product
+      int calls = calls_per_rep(A->local_nnz);
+#ifdef USING_MPI
+      int min_calls;
+      MPI_Allreduce(&calls, &min_calls, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+      calls = min_calls;
+#endif
+      // Once with each instruction set this processor supports, both
+      // generic and unrolled for the matrix's row width if it has one,
+      // with double and float values and value codes if the matrix has
+      // few enough distinct values, and with 32 and 16-bit indices if
+      // any row has them
+      YAML_Element * spmv_threads = spmv_doc->add(key,"");
+      for (int isa=SIMD_SCALAR; isa<=best_isa; isa++)
+	for (int fixed=0; fixed<=(row_width ? 1 : 0); fixed++)
+	  for (int values=0; values<=(have_codes ? 2 : 1); values++)
+	    for (int compressed=0; compressed<=(short_inds ? 1 : 0); compressed++)
+	      {
+		bool single = values==1, coded = values==2;
+		simd_select_isa(isa);
+		A->row_width = fixed ? row_width : 0;
+		A->ptr_to_val_codes_in_row = coded ? val_codes : 0;
+		A->ptr_to_short_inds_in_row = compressed ? short_inds : 0;
+		bool full_precision = !single;
+		for (int k=0; k<warmup; k++) HPC_sparsemv(A, v1, v3, full_precision);
+		for (int rep=0; rep<reps; rep++)
+		  {
+		    double t0 = mytimer();
+		    for (int k=0; k<calls; k++) HPC_sparsemv(A, v1, v3, full_precision);
+		    times[rep] = (mytimer() - t0)/calls;
+		  }
+		char name[64];
+		sprintf(name, "%s", simd_isa_names[isa]);
+		if (fixed) sprintf(name+strlen(name), ", row width %d", row_width);
+		if (single) strcat(name, ", float values");
+		if (coded) strcat(name, ", value codes");
+		if (compressed) strcat(name, ", 16-bit indices");
+		YAML_Element * element = spmv_threads->add(name,"");
+		double median = add_statistics(element, times);
+		element->add("MFLOPS",2.0*total_nnz/median/1.0E6);
+		double bytes = bytes_sparsemv - (single ? float_saving : 0.0)
+		  - (coded ? code_saving : 0.0) - (compressed ? short_saving : 0.0);
+		element->add("GB/s",bytes/median/1.0E9);
+	      }
+      simd_select_isa(best_isa);
+      A->row_width = row_width;
+      A->ptr_to_val_codes_in_row = 0;
+      A->ptr_to_short_inds_in_row = short_inds;
+
+      // The blocks with the generic kernel and the one compiled for AVX2
+      for (int isa=SIMD_SCALAR; have_blocks && isa<=best_isa; isa++)
+	{
+	  if (isa!=SIMD_SCALAR && isa!=SIMD_AVX2) continue;
+	  simd_select_isa(isa);
+	  A->block_row_start = block_row_start;
+	  for (int k=0; k<warmup; k++) HPC_sparsemv(A, v1, v3);
+	  for (int rep=0; rep<reps; rep++)
+	    {
+	      double t0 = mytimer();
+	      for (int k=0; k<calls; k++) HPC_sparsemv(A, v1, v3);
+	      times[rep] = (mytimer() - t0)/calls;
+	    }
+	  char name[64];
+	  sprintf(name, "%s, %dx%d blocks", simd_isa_names[isa], block_size, block_size);
+	  YAML_Element * element = spmv_threads->add(name,"");
+	  double median = add_statistics(element, times);
+	  element->add("MFLOPS",2.0*total_nnz/median/1.0E6);
+	  element->add("GB/s",bytes_blocks/median/1.0E9);
+	  A->block_row_start = 0;
+	}
+      simd_select_isa(best_isa);
+
+      if (have_sym)
+	{
+	  A->sym_row_start = sym_row_start;
+	  for (int k=0; k<warmup; k++) HPC_sparsemv(A, v1, v3);
+	  for (int rep=0; rep<reps; rep++)
+	    {
+	      double t0 = mytimer();
+	      for (int k=0; k<calls; k++) HPC_sparsemv(A, v1, v3);
+	      times[rep] = (mytimer() - t0)/calls;
+	    }
+	  YAML_Element * element = spmv_threads->add("Symmetric","");
+	  double median = add_statistics(element, times);
+	  element->add("MFLOPS",2.0*total_nnz/median/1.0E6);
+	  element->add("GB/s",bytes_symmetric/median/1.0E9);
+	  A->sym_row_start = 0;
+	}
+
+      // Vector kernels, without MPI_Allreduce in the ddot timing
+      YAML_Element * ddot_threads = ddot_doc->add(key,"");
+      YAML_Element * waxpby_threads = waxpby_doc->add(key,"");
+      for (size_t il=0; il<lengths.size(); il++)
+	{
+	  int n = lengths[il];
+	  if (n<1) continue;
+	  sprintf(key, "Length %d", n);
+	  calls = calls_per_rep(n);
+	  double result = 0.0, t_allreduce = 0.0;
+	  for (int k=0; k<warmup; k++) ddot(n, v1, v2, &result, t_allreduce);
+	  for (int rep=0; rep<reps; rep++)
+	    {
+	      t_allreduce = 0.0;
+	      double t0 = mytimer();
+	      for (int k=0; k<calls; k++) ddot(n, v1, v2, &result, t_allreduce);
+	      times[rep] = (mytimer() - t0 - t_allreduce)/calls;
+	    }
+	  YAML_Element * element = ddot_threads->add(key,"");
+	  double median = add_statistics(element, times);
+	  element->add("MFLOPS",2.0*n*size/median/1.0E6);
+	  element->add("GB/s",2.0*sizeof(double)*n*size/median/1.0E9);
+
+	  for (int k=0; k<warmup; k++) waxpby(n, 1.5, v1, 0.5, v2, v3);
+	  for (int rep=0; rep<reps; rep++)
+	    {
+	      double t0 = mytimer();
+	      for (int k=0; k<calls; k++) waxpby(n, 1.5, v1, 0.5, v2, v3);
+	      times[rep] = (mytimer() - t0)/calls;
+	    }
+	  element = waxpby_threads->add(key,"");
+	  median = add_statistics(element, times);
+	  element->add("MFLOPS",3.0*n*size/median/1.0E6);
+	  element->add("GB/s",3.0*sizeof(double)*n*size/median/1.0E9);
+	}
+    }
+
+#ifdef USING_MPI
+  // Halo exchange of the matrix, and a pairwise exchange of each message
+  // size between ranks 2i and 2i+1 (the last rank idles if size is odd).
+  if (size>1)
+    {
+      double t_wait = 0.0;
+      for (int k=0; k<warmup; k++) exchange_externals(A, v1, t_wait);
+      for (int rep=0; rep<reps; rep++)
+	{
+	  MPI_Barrier(MPI_COMM_WORLD);
+	  double t0 = mytimer();
+	  exchange_externals(A, v1, t_wait);
+	  times[rep] = mytimer() - t0;
+	}
+      YAML_Element * element = doc.add("HALO EXCHANGE","");
+      long long local_volume = A->total_to_be_sent, volume = 0;
+      MPI_Allreduce(&local_volume, &volume, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+      element->add("Bytes sent",8*volume);
+      double median = add_statistics(element, times);
+      element->add("GB/s",8.0*volume/median/1.0E9);
+
+      int partner = rank^1;
+      YAML_Element * messages_doc = doc.add("MESSAGES","");
+      for (size_t im=0; im<messages.size(); im++)
+	{
+	  int nbytes = messages[im];
+	  if (nbytes<1) continue;
+	  std::vector<char> send(nbytes, 1), recv(nbytes);
+	  int calls = calls_per_rep(nbytes + 2000.0); // Assume a latency of about 2 us
+	  for (int rep=-warmup; rep<reps; rep++)
+	    {
+	      MPI_Barrier(MPI_COMM_WORLD);
+	      double t0 = mytimer();
+	      if (partner<size)
+		for (int k=0; k<calls; k++)
+		  MPI_Sendrecv(&send[0], nbytes, MPI_CHAR, partner, 99,
+			       &recv[0], nbytes, MPI_CHAR, partner, 99,
+			       MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+	      if (rep>=0) times[rep] = (mytimer() - t0)/calls;
+	    }
+	  sprintf(key, "Bytes %d", nbytes);
+	  element = messages_doc->add(key,"");
+	  median = add_statistics(element, times);
+	  element->add("GB/s per rank",2.0*nbytes/median/1.0E9); // Sent and received
+	}
+    }
+#endif
+
+  if (rank==0) doc.generate(cout, json);
+
+  delete [] v1;
+  delete [] v2;
+  delete [] v3;
+#ifdef USING_MPI
+  MPI_Finalize();
+#endif
+  return 0;
+}
@@ -0,0 +1,258 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Routines to store a matrix in dense blocks (BCSR) and multiply by it.
+
+// Problems with several unknowns per node, e.g. the 3 displacements of
+// elasticity, have their nonzeros in dense blocks.  Stored by blocks,
+// one column index serves b*b values, and the kernel loads b entries
+// of x per block and keeps the b sums of a block row in registers.
+
+// block_matrix_bytes - Counts, for each block row, the distinct blocks
+//                      its rows touch.  Entries missing from a block
+//                      are stored as zeros, so sizes that do not fit
+//                      the structure cost more than the rows.
+
+// make_block_matrix - Tries each size from min_block_size to
+//                     max_block_size and keeps the one with the fewest
+//                     bytes, if it beats the rows' values, indices and
+//                     lengths.  The blocks of a block row are sorted by
+//                     column and each is stored row by row.  The copy
+//                     is made in parallel (see first touch in
+//                     tracked_memory.hpp).  The rows are kept for the
+//                     rest of the code.
+
+// sparsemv_block - A template on the block size, so each block is
+//                  fully unrolled.  It is also compiled for AVX2 and
+//                  FMA, used when simd_isa allows, so the compiler can
+//                  vectorize within the blocks.  Block rows are split
+//                  over threads with the schedule sparsemv_set_chunk sets.
+
+/////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <algorithm>
+#include "block_matrix.hpp"
+#include "sparsemv_simd.hpp"
+#include "tracked_memory.hpp"
+
+// Sorted first columns of the blocks that rows b*I to b*I+b-1 touch
+static void block_columns(const HPC_Sparse_Matrix * A, int b, int I, std::vector<int> & cols)
+{
+  cols.clear();
+  for (int i=b*I; i<b*I+b; i++)
+    for (int j=0; j<A->nnz_in_row[i]; j++)
+      cols.push_back(A->ptr_to_inds_in_row[i][j]/b*b);
+  std::sort(cols.begin(), cols.end());
+  cols.erase(std::unique(cols.begin(), cols.end()), cols.end());
+}
+
+double block_matrix_bytes(const HPC_Sparse_Matrix * A, int b, long long & nblocks)
+{
+  nblocks = 0;
+  if (A->local_nrow%b!=0) return(0.0);
+  const int nblock_rows = A->local_nrow/b;
+  bool fits = true;
+#ifdef USING_OMP
+#pragma omp parallel
+#endif
+  {
+    std::vector<int> cols;
+    long long my_blocks = 0;
+    bool my_fits = true;
+#ifdef USING_OMP
+#pragma omp for schedule(static)
+#endif
+    for (int I=0; I<nblock_rows; I++)
+      {
+	block_columns(A, b, I, cols);
+	my_blocks += cols.size();
+	if (!cols.empty() && cols.back()+b>A->local_ncol) my_fits = false;
+      }
+#ifdef USING_OMP
+#pragma omp critical
+#endif
+    {
+      nblocks += my_blocks;
+      fits = fits && my_fits;
+    }
+  }
+  if (!fits) return(0.0);
+  return((sizeof(double)*b*b + sizeof(int))*(double) nblocks + sizeof(int)*(double) (nblock_rows+1));
+}
+
+int make_block_matrix(HPC_Sparse_Matrix * A)
+{
+  if (A->block_row_start) tracked_delete(A->block_row_start);
+  if (A->list_of_block_cols) tracked_delete(A->list_of_block_cols);
+  if (A->list_of_block_vals) tracked_delete(A->list_of_block_vals);
+  A->block_size = 0;
+  A->block_row_start = 0;
+  A->list_of_block_cols = 0;
+  A->list_of_block_vals = 0;
+
+  double nnz = 0.0;
+  for (int i=0; i<A->local_nrow; i++) nnz += A->nnz_in_row[i];
+  double best_bytes = (sizeof(double)+sizeof(int))*nnz + sizeof(int)*(double) A->local_nrow;
+  int b = 0;
+  for (int size=min_block_size; size<=max_block_size; size++)
+    {
+      long long nblocks;
+      double bytes = block_matrix_bytes(A, size, nblocks);
+      if (bytes>0.0 && bytes<best_bytes)
+	{
+	  best_bytes = bytes;
+	  b = size;
+	}
+    }
+  if (b==0) return(0);
+
+  const int nblock_rows = A->local_nrow/b;
+  int * block_row_start = tracked_new<int>(nblock_rows+1, MEM_ROW_METADATA);
+  std::vector<int> cols;
+  block_row_start[0] = 0;
+  for (int I=0; I<nblock_rows; I++)
+    {
+      block_columns(A, b, I, cols);
+      block_row_start[I+1] = block_row_start[I] + cols.size();
+    }
+  const int nblocks = block_row_start[nblock_rows];
+  int * list_of_block_cols = tracked_new<int>(nblocks, MEM_INDICES);
+  double * list_of_block_vals = tracked_new<double>(((long long) nblocks)*b*b, MEM_VALUES);
+#ifdef USING_OMP
+#pragma omp parallel for schedule(static) firstprivate(cols)
+#endif
+  for (int I=0; I<nblock_rows; I++)
+    {
+      block_columns(A, b, I, cols);
+      int * const cur_cols = list_of_block_cols + block_row_start[I];
+      double * const cur_vals = list_of_block_vals + ((long long) block_row_start[I])*b*b;
+      for (size_t k=0; k<cols.size(); k++) cur_cols[k] = cols[k];
+      for (size_t k=0; k<cols.size()*b*b; k++) cur_vals[k] = 0.0;
+      for (int r=0; r<b; r++)
+	{
+	  const int i = b*I+r;
+	  for (int j=0; j<A->nnz_in_row[i]; j++)
+	    {
+	      const int col = A->ptr_to_inds_in_row[i][j];
+	      int k = std::lower_bound(cols.begin(), cols.end(), col/b*b) - cols.begin();
+	      cur_vals[(k*b + r)*b + col%b] += A->ptr_to_vals_in_row[i][j];
+	    }
+	}
+    }
+
+  A->block_size = b;
+  A->block_row_start = block_row_start;
+  A->list_of_block_cols = list_of_block_cols;
+  A->list_of_block_vals = list_of_block_vals;
+  return(b);
+}
+
+#ifdef USING_OMP
+#define OMP_FOR_ROWS _Pragma("omp parallel for schedule(runtime)")
+#else
+#define OMP_FOR_ROWS
+#endif
+
+// One block row of B rows
+template <int B> static inline __attribute__((always_inline))
+void block_row(const double * const vals, const int * const cols, const int nblocks,
+	       const double * const x, double * const y)
+{
+  double sum[B];
+  for (int r=0; r<B; r++) sum[r] = 0.0;
+  for (int k=0; k<nblocks; k++)
+    {
+      const double * const cur_vals = vals + k*B*B;
+      const double * const cur_x = x + cols[k];
+      for (int r=0; r<B; r++)
+	for (int c=0; c<B; c++)
+	  sum[r] += cur_vals[r*B+c]*cur_x[c];
+    }
+  for (int r=0; r<B; r++) y[r] = sum[r];
+}
+
+#define BLOCK_ROWS(B)							\
+  const int nblock_rows = A->local_nrow/B;				\
+  const int * const block_row_start = A->block_row_start;		\
+  OMP_FOR_ROWS							\
+  for (int I=0; I<nblock_rows; I++)					\
+    block_row<B>(A->list_of_block_vals + ((long long) block_row_start[I])*B*B, \
+		 A->list_of_block_cols + block_row_start[I],		\
+		 block_row_start[I+1]-block_row_start[I], x, y + B*I);
+
+template <int B>
+static void sparsemv_block_generic(HPC_Sparse_Matrix * A, const double * const x, double * const y)
+{
+  BLOCK_ROWS(B)
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BLOCK_AVX2
+template <int B> __attribute__((target("avx2,fma")))
+static void sparsemv_block_avx2(HPC_Sparse_Matrix * A, const double * const x, double * const y)
+{
+  BLOCK_ROWS(B)
+}
+#endif
+
+#ifdef BLOCK_AVX2
+#define SPARSEMV_BLOCK(B)						\
+  if (simd_isa>=SIMD_AVX2) sparsemv_block_avx2<B>(A, x, y);		\
+  else sparsemv_block_generic<B>(A, x, y);
+#else
+#define SPARSEMV_BLOCK(B) sparsemv_block_generic<B>(A, x, y);
+#endif
+
+int sparsemv_block(HPC_Sparse_Matrix * A, const double * const x, double * const y)
+{
+  switch (A->block_size)
+    {
+    case 2: SPARSEMV_BLOCK(2) break;
+    case 3: SPARSEMV_BLOCK(3) break;
+    case 4: SPARSEMV_BLOCK(4) break;
+    default: return(-1);
+    }
+  return(0);
+}
@@ -39,44 +39,27 @@
 // 
 // ************************************************************************
 //@HEADER
-/////////////////////////////////////////////////////////////////////////
 
-// Routine to dump matrix in row, col, val format for analysis with Matlab
-// Writes to mat.dat
-// NOTE:  THIS CODE ONLY WORKS ON SINGLE PROCESSOR RUNS
-// Read into matlab using:
-//   load mat.dat
-//   A=spconvert(mat);
+#ifndef BLOCK_MATRIX_H
+#define BLOCK_MATRIX_H
+#include "HPC_Sparse_Matrix.hpp"
 
-// A - known matrix 
+// Block sizes with a kernel
+const int min_block_size = 2;
+const int max_block_size = 4;
 
-/////////////////////////////////////////////////////////////////////////
+// Bytes of A's values and indices stored in b by b blocks, with the
+// zeros that fill them out, or 0 if the local rows do not divide into
+// blocks of b or a block would reach past the last column.  nblocks is
+// set to the number of blocks.
+double block_matrix_bytes(const HPC_Sparse_Matrix * A, int b, long long & nblocks);
 
-#include <cstdio>
-#include "dump_matlab_matrix.hpp"
+// Picks the block size that stores A in the fewest bytes and makes A's
+// copy in blocks of that size, which HPC_sparsemv then uses.  Returns
+// the block size, or 0 if no size takes fewer bytes than the rows
+// themselves; then no copy is made.
+int make_block_matrix(HPC_Sparse_Matrix * A);
 
-int dump_matlab_matrix( HPC_Sparse_Matrix *A, int rank) {
-  const int nrow = A->local_nrow;
-  int start_row = nrow*rank; // Each processor gets a section of a chimney stack domain
-
-  FILE * handle = 0;
-  if (rank==0) 
-    handle = fopen("mat0.dat", "w");
-  else if (rank==1)
-    handle = fopen("mat1.dat", "w");
-  else if (rank==2)
-    handle = fopen("mat2.dat", "w");
-  else if (rank==3)
-    handle = fopen("mat3.dat", "w");
-  else return(0);
-
-  for (int i=0; i< nrow; i++) {
-      const double * const cur_vals = A->ptr_to_vals_in_row[i];
-      const int    * const cur_inds = A->ptr_to_inds_in_row[i];
-      const int cur_nnz = A->nnz_in_row[i];
-      for (int j=0; j< cur_nnz; j++) fprintf(handle, " %d %d %22.16e\n",start_row+i+1,cur_inds[j]+1,cur_vals[j]);
-    }
-
-  fclose(handle);
-  return(0);
-}
+// y = Ax from A's blocks.  First call exchange_externals.
+int sparsemv_block(HPC_Sparse_Matrix * A, const double * const x, double * const y);
+#endif
@@ -0,0 +1,262 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Routines to checkpoint and restart the state of HPCCG.
+
+// checkpoint_init - Sets the checkpoint interval, file prefix and
+//                   whether to restart.
+
+// checkpoint_save - Copies x, r, p and the scalars into a staging buffer
+//                   and writes them to prefix.rank.slot in a background
+//                   thread, so the solver only waits for the copy (and
+//                   for the previous write, if it has not finished).
+//                   Files are written to a temporary name and renamed
+//                   when complete; the two slots alternate so the last
+//                   complete checkpoint survives a failure mid-write.
+
+// checkpoint_restore - Finds the latest iteration that has a complete
+//                      checkpoint on every processor and loads it.
+//                      Returns that iteration, or 0 if there is none.
+
+// checkpoint_finish - Waits for any outstanding write.
+
+/////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+using std::cerr;
+using std::endl;
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include "mytimer.hpp"
+#include "checkpoint.hpp"
+#include "hpccg_comm.hpp"
+
+const int checkpoint_magic = 0x48504347; // "HPCG"
+
+static void checkpoint_name(char * name, const char * prefix, int rank, int slot)
+{
+  sprintf(name, "%s.%d.%d", prefix, rank, slot);
+}
+
+static void * write_checkpoint(void * arg)
+{
+  HPCCG_Checkpoint * ckpt = (HPCCG_Checkpoint *) arg;
+  char name[1024], tmp_name[1040];
+  checkpoint_name(name, ckpt->prefix, ckpt->rank, ckpt->write_slot);
+  sprintf(tmp_name, "%s.tmp", name);
+
+  FILE * handle = fopen(tmp_name, "wb");
+  if (handle==0)
+    {
+      ckpt->failed = true;
+      return(0);
+    }
+  int header[4] = {checkpoint_magic, ckpt->nprocs, ckpt->nrow, ckpt->write_iteration};
+  size_t n = checkpoint_num_scalars + 3*(size_t) ckpt->nrow;
+  bool ok = fwrite(header, sizeof(int), 4, handle)==4 &&
+    fwrite(ckpt->staging, sizeof(double), n, handle)==n &&
+    fwrite(&checkpoint_magic, sizeof(int), 1, handle)==1;
+  ok = ok && fflush(handle)==0 && fsync(fileno(handle))==0;
+  ok = (fclose(handle)==0) && ok;
+  ok = ok && rename(tmp_name, name)==0;
+  if (!ok) ckpt->failed = true;
+  return(0);
+}
+
+// Returns the iteration stored in a slot, or -1 if it is missing or
+// incomplete.  If data is not 0, the saved state is also read into it.
+static int read_checkpoint(HPCCG_Checkpoint * ckpt, int slot, int nrow, double * data)
+{
+  char name[1024];
+  checkpoint_name(name, ckpt->prefix, ckpt->rank, slot);
+  FILE * handle = fopen(name, "rb");
+  if (handle==0) return(-1);
+
+  int header[4], trailer = 0;
+  size_t n = checkpoint_num_scalars + 3*(size_t) nrow;
+  int iteration = -1;
+  if (fread(header, sizeof(int), 4, handle)==4 && header[0]==checkpoint_magic &&
+      header[1]==ckpt->nprocs && header[2]==nrow)
+    {
+      if (data)
+	{
+	  if (fread(data, sizeof(double), n, handle)==n &&
+	      fread(&trailer, sizeof(int), 1, handle)==1 && trailer==checkpoint_magic)
+	    iteration = header[3];
+	}
+      else if (fseek(handle, n*sizeof(double), SEEK_CUR)==0 &&
+	       fread(&trailer, sizeof(int), 1, handle)==1 && trailer==checkpoint_magic)
+	iteration = header[3];
+    }
+  fclose(handle);
+  return(iteration);
+}
+
+static int global_min(int value)
+{
+#ifdef USING_MPI
+  int result;
+  MPI_Allreduce(&value, &result, 1, MPI_INT, MPI_MIN, hpccg_comm);
+  return(result);
+#else
+  return(value);
+#endif
+}
+
+void checkpoint_init(HPCCG_Checkpoint * ckpt, int interval, const char * prefix, int restart)
+{
+  ckpt->interval = interval;
+  ckpt->prefix = prefix;
+  ckpt->restart = restart;
+  ckpt->restart_iteration = 0;
+  ckpt->num_written = 0;
+  ckpt->overhead_time = 0.0;
+  ckpt->failed = false;
+#ifdef USING_MPI
+  MPI_Comm_rank(hpccg_comm, &ckpt->rank);
+  MPI_Comm_size(hpccg_comm, &ckpt->nprocs);
+#else
+  ckpt->rank = 0;
+  ckpt->nprocs = 1;
+#endif
+  ckpt->nrow = 0;
+  ckpt->slot = 0;
+  ckpt->write_slot = 0;
+  ckpt->write_iteration = 0;
+  ckpt->staging = 0;
+  ckpt->writing = false;
+}
+
+void checkpoint_save(HPCCG_Checkpoint * ckpt, int nrow, int iteration,
+		     const double * x, const double * r, const double * p,
+		     const double * scalars)
+{
+  double t0 = mytimer();
+  if (ckpt->writing) pthread_join(ckpt->writer, 0); // Previous write must finish first
+  ckpt->writing = false;
+
+  if (ckpt->staging==0 || ckpt->nrow!=nrow)
+    {
+      delete [] ckpt->staging;
+      ckpt->staging = new double[checkpoint_num_scalars + 3*(size_t) nrow];
+      ckpt->nrow = nrow;
+    }
+  double * s = ckpt->staging;
+  memcpy(s, scalars, checkpoint_num_scalars*sizeof(double)); s += checkpoint_num_scalars;
+  memcpy(s, x, nrow*sizeof(double)); s += nrow;
+  memcpy(s, r, nrow*sizeof(double)); s += nrow;
+  memcpy(s, p, nrow*sizeof(double));
+
+  ckpt->write_slot = ckpt->slot;
+  ckpt->write_iteration = iteration;
+  if (pthread_create(&ckpt->writer, 0, write_checkpoint, ckpt)==0)
+    ckpt->writing = true;
+  else
+    write_checkpoint(ckpt); // No thread available, write in the foreground
+  ckpt->slot = 1 - ckpt->slot;
+  ckpt->num_written++;
+  ckpt->overhead_time += mytimer() - t0;
+}
+
+int checkpoint_restore(HPCCG_Checkpoint * ckpt, int nrow,
+		       double * x, double * r, double * p, double * scalars)
+{
+  double t0 = mytimer();
+  int it[2];
+  it[0] = read_checkpoint(ckpt, 0, nrow, 0);
+  it[1] = read_checkpoint(ckpt, 1, nrow, 0);
+
+  // All processors checkpoint the same iterations, but a failure can
+  // leave some of them a checkpoint behind.  Try the newest iteration
+  // every processor could have, then the one before it.
+  int candidate = global_min(it[0]>it[1] ? it[0] : it[1]);
+  int slot = -1;
+  for (int attempt=0; attempt<2 && candidate>0; attempt++)
+    {
+      slot = (it[0]==candidate) ? 0 : ((it[1]==candidate) ? 1 : -1);
+      if (global_min(slot)>=0) break;
+      slot = -1;
+      int older = -1;
+      for (int s=0; s<2; s++)
+	if (it[s]<candidate && it[s]>older) older = it[s];
+      candidate = global_min(older);
+    }
+
+  int iteration = 0;
+  if (global_min(slot)>=0)
+    {
+      double * data = new double[checkpoint_num_scalars + 3*(size_t) nrow];
+      int ok = read_checkpoint(ckpt, slot, nrow, data)==candidate;
+      if (global_min(ok))
+	{
+	  double * s = data;
+	  memcpy(scalars, s, checkpoint_num_scalars*sizeof(double)); s += checkpoint_num_scalars;
+	  memcpy(x, s, nrow*sizeof(double)); s += nrow;
+	  memcpy(r, s, nrow*sizeof(double)); s += nrow;
+	  memcpy(p, s, nrow*sizeof(double));
+	  iteration = candidate;
+	  ckpt->slot = 1 - slot; // Keep this checkpoint until a newer one is complete
+	}
+      delete [] data;
+    }
+  if (iteration==0 && ckpt->rank==0)
+    cerr << "No complete checkpoint found with prefix " << ckpt->prefix
+	 << ", starting from the beginning" << endl;
+  ckpt->restart_iteration = iteration;
+  ckpt->overhead_time += mytimer() - t0;
+  return(iteration);
+}
+
+void checkpoint_finish(HPCCG_Checkpoint * ckpt)
+{
+  double t0 = mytimer();
+  if (ckpt->writing) pthread_join(ckpt->writer, 0);
+  ckpt->writing = false;
+  delete [] ckpt->staging;
+  ckpt->staging = 0;
+  if (ckpt->failed && ckpt->rank==0)
+    cerr << "Warning: writing a checkpoint with prefix " << ckpt->prefix << " failed" << endl;
+  ckpt->overhead_time += mytimer() - t0;
+}
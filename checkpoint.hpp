@@ -0,0 +1,87 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+#ifdef USING_MPI
+#include <mpi.h>
+#endif
+#include <pthread.h>
+
+// Solver state saved in a checkpoint, besides x, r and p:
+// rtrans, then the t1..t5 accumulators, the elapsed time of HPCCG and
+// the time waiting in exchange_externals.
+const int checkpoint_num_scalars = 8;
+
+struct HPCCG_Checkpoint_STRUCT {
+  // Set by the caller (see checkpoint_init)
+  int interval;         // Iterations between checkpoints, 0 to disable
+  const char * prefix;  // Files are named prefix.rank.slot
+  int restart;          // Resume from the latest complete checkpoint
+
+  // Set by the checkpoint routines
+  int restart_iteration;  // Iteration resumed from, 0 if none
+  int num_written;        // Checkpoints started in this run
+  double overhead_time;   // Time the solver was stalled by checkpointing
+  bool failed;            // A background write failed
+
+  // Internal state
+  int rank;
+  int nprocs;
+  int nrow;
+  int slot;               // Slot (0 or 1) for the next checkpoint
+  int write_slot;         // Slot being written in the background
+  int write_iteration;    // Iteration being written in the background
+  double * staging;       // Copy of the state being written
+  bool writing;
+  pthread_t writer;
+};
+typedef struct HPCCG_Checkpoint_STRUCT HPCCG_Checkpoint;
+
+void checkpoint_init(HPCCG_Checkpoint * ckpt, int interval, const char * prefix, int restart);
+void checkpoint_save(HPCCG_Checkpoint * ckpt, int nrow, int iteration,
+		     const double * x, const double * r, const double * p,
+		     const double * scalars);
+int checkpoint_restore(HPCCG_Checkpoint * ckpt, int nrow,
+		       double * x, double * r, double * p, double * scalars);
+void checkpoint_finish(HPCCG_Checkpoint * ckpt);
+#endif
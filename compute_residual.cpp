@@ -55,6 +55,7 @@
 #include <cmath>  // needed for fabs
 using std::fabs;
 #include "compute_residual.hpp"
+#include "hpccg_comm.hpp"
 
 int compute_residual(const int n, const double * const v1, 
 		     const double * const v2, double * const residual)
@@ -71,7 +72,7 @@ int compute_residual(const int n, const double * const v1,
   double global_residual = 0;
   
   MPI_Allreduce(&local_residual, &global_residual, 1, MPI_DOUBLE, MPI_MAX,
-                MPI_COMM_WORLD);
+                hpccg_comm);
   *residual = global_residual;
 #else
   *residual = local_residual;
@@ -53,18 +53,19 @@
 /////////////////////////////////////////////////////////////////////////
 
 #include "ddot.hpp"
+#include "hpccg_comm.hpp"
 int ddot (const int n, const double * const x, const double * const y, 
 	  double * const result, double & time_allreduce)
 {  
   double local_result = 0.0;
   if (y==x)
 #ifdef USING_OMP
-#pragma omp parallel for reduction (+:local_result)
+#pragma omp parallel for schedule(static) reduction (+:local_result)
 #endif
     for (int i=0; i<n; i++) local_result += x[i]*x[i];
   else
 #ifdef USING_OMP
-#pragma omp parallel for reduction (+:local_result)
+#pragma omp parallel for schedule(static) reduction (+:local_result)
 #endif
     for (int i=0; i<n; i++) local_result += x[i]*y[i];
 
@@ -73,7 +74,7 @@ int ddot (const int n, const double * const x, const double * const y,
   double t0 = mytimer();
   double global_result = 0.0;
   MPI_Allreduce(&local_result, &global_result, 1, MPI_DOUBLE, MPI_SUM, 
-                MPI_COMM_WORLD);
+                hpccg_comm);
   *result = global_result;
   time_allreduce += mytimer() - t0;
 #else
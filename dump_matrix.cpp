@@ -0,0 +1,219 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Routine to write a matrix (and its vectors) from all processors into
+// a single shared file.
+
+// A - known matrix, still using global indices (before make_local_matrix)
+
+// x, b, xexact - initial guess, right hand side and exact solution
+
+// filename - If it ends in ".mtx" the matrix is written in Matrix Market
+//            coordinate format (vectors are not written), readable in
+//            Matlab with mmread.  Otherwise it is written in the HPC row
+//            format read by read_HPC_row.
+
+// bytes_written - On exit, total size of the file.
+
+// Each processor formats its rows into a memory buffer, computes its
+// offset in the file with a prefix sum over the buffer sizes, and all
+// processors then write their pieces with collective MPI-IO.
+
+/////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+using std::cerr;
+using std::endl;
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "dump_matrix.hpp"
+#include "hpccg_comm.hpp"
+
+#ifdef USING_MPI
+typedef MPI_File dump_file_t;
+#else
+typedef FILE * dump_file_t;
+#endif
+
+static void append(std::vector<char> & buf, const char * text, int len)
+{
+  buf.insert(buf.end(), text, text+len);
+}
+
+// Writes each processor's buf, in processor order, starting at base.
+// Returns the file offset following the section.
+static long long write_section(dump_file_t handle, long long base, std::vector<char> & buf)
+{
+  long long len = buf.size();
+#ifdef USING_MPI
+  int rank;
+  MPI_Comm_rank(hpccg_comm, &rank);
+  long long offset = 0, total = 0;
+  MPI_Exscan(&len, &offset, 1, MPI_LONG_LONG, MPI_SUM, hpccg_comm);
+  if (rank==0) offset = 0;
+  MPI_Allreduce(&len, &total, 1, MPI_LONG_LONG, MPI_SUM, hpccg_comm);
+
+  // MPI counts are ints, so write in chunks.  Every processor must make
+  // the same number of collective calls.
+  const long long chunk = 1<<30;
+  long long nchunks = (len+chunk-1)/chunk, max_nchunks = 0;
+  MPI_Allreduce(&nchunks, &max_nchunks, 1, MPI_LONG_LONG, MPI_MAX, hpccg_comm);
+  for (long long c=0; c<max_nchunks; c++)
+    {
+      long long start = c*chunk;
+      int count = 0;
+      if (start<len) count = (int) ((len-start<chunk) ? len-start : chunk);
+      MPI_Status status;
+      MPI_File_write_at_all(handle, (MPI_Offset) (base+offset+start),
+			    count ? &buf[start] : 0, count, MPI_CHAR, &status);
+    }
+  std::vector<char>().swap(buf);
+  return(base+total);
+#else
+  if (len>0) fwrite(&buf[0], 1, len, handle);
+  std::vector<char>().swap(buf);
+  return(base+len);
+#endif
+}
+
+int dump_matrix(HPC_Sparse_Matrix *A, const double *x, const double *b,
+		const double *xexact, const char *filename, long long & bytes_written)
+{
+  int i, j;
+  int rank = 0;
+#ifdef USING_MPI
+  MPI_Comm_rank(hpccg_comm, &rank);
+#endif
+  const int nrow = A->local_nrow;
+  const int start_row = A->start_row;
+
+  size_t name_len = strlen(filename);
+  bool matrix_market = name_len>4 && strcmp(filename+name_len-4, ".mtx")==0;
+
+  long long local_nnz = 0, total_nnz = 0;
+  for (i=0; i<nrow; i++) local_nnz += A->nnz_in_row[i];
+#ifdef USING_MPI
+  MPI_Allreduce(&local_nnz, &total_nnz, 1, MPI_LONG_LONG, MPI_SUM, hpccg_comm);
+#else
+  total_nnz = local_nnz;
+#endif
+
+  dump_file_t handle;
+#ifdef USING_MPI
+  int err = MPI_File_open(hpccg_comm, (char *) filename,
+			  MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &handle);
+  if (err==MPI_SUCCESS) MPI_File_set_size(handle, 0);
+#else
+  handle = fopen(filename, "w");
+  int err = (handle==0);
+#endif
+  if (err)
+    {
+      if (rank==0) cerr << "Error: Cannot open file: " << filename << endl;
+      return(-1);
+    }
+
+  std::vector<char> buf;
+  char line[128];
+  long long offset = 0;
+
+  // Header
+  if (rank==0)
+    {
+      if (matrix_market)
+	{
+	  append(buf, line, sprintf(line, "%%%%MatrixMarket matrix coordinate real general\n"));
+	  append(buf, line, sprintf(line, "%d %d %lld\n", A->total_nrow, A->total_nrow, total_nnz));
+	}
+      else
+	append(buf, line, sprintf(line, "%d %lld\n", A->total_nrow, total_nnz));
+    }
+  offset = write_section(handle, offset, buf);
+
+  if (matrix_market)
+    {
+      buf.reserve(local_nnz*32);
+      for (i=0; i<nrow; i++)
+	{
+	  const double * const cur_vals = A->ptr_to_vals_in_row[i];
+	  const int    * const cur_inds = A->ptr_to_inds_in_row[i];
+	  for (j=0; j<A->nnz_in_row[i]; j++)
+	    append(buf, line, sprintf(line, "%d %d %.17g\n", start_row+i+1, cur_inds[j]+1, cur_vals[j]));
+	}
+      offset = write_section(handle, offset, buf);
+    }
+  else
+    {
+      // Row lengths, then rows, then vectors
+      buf.reserve(nrow*4);
+      for (i=0; i<nrow; i++)
+	append(buf, line, sprintf(line, "%d\n", A->nnz_in_row[i]));
+      offset = write_section(handle, offset, buf);
+
+      buf.reserve(local_nnz*32);
+      for (i=0; i<nrow; i++)
+	{
+	  const double * const cur_vals = A->ptr_to_vals_in_row[i];
+	  const int    * const cur_inds = A->ptr_to_inds_in_row[i];
+	  append(buf, line, sprintf(line, "%d\n", A->nnz_in_row[i]));
+	  for (j=0; j<A->nnz_in_row[i]; j++)
+	    append(buf, line, sprintf(line, "%.17g %d\n", cur_vals[j], cur_inds[j]));
+	}
+      offset = write_section(handle, offset, buf);
+
+      buf.reserve(nrow*72);
+      for (i=0; i<nrow; i++)
+	append(buf, line, sprintf(line, "%.17g %.17g %.17g\n", x[i], b[i], xexact[i]));
+      offset = write_section(handle, offset, buf);
+    }
+
+#ifdef USING_MPI
+  MPI_File_close(&handle);
+#else
+  fclose(handle);
+#endif
+  bytes_written = offset;
+  return(0);
+}
@@ -47,8 +47,9 @@ using std::endl;
 #include <cstdlib>
 #include <cstdio>
 #include "exchange_externals.hpp"
+#include "hpccg_comm.hpp"
 #undef DEBUG
-void exchange_externals(HPC_Sparse_Matrix * A, const double *x)
+void exchange_externals(HPC_Sparse_Matrix * A, const double *x, double & time_wait)
 {
   int i, j, k;
   int num_external = 0;
@@ -65,8 +66,8 @@ void exchange_externals(HPC_Sparse_Matrix * A, const double *x)
   int * elements_to_send = A->elements_to_send;
   
   int size, rank; // Number of MPI processes, My process ID
-  MPI_Comm_size(MPI_COMM_WORLD, &size);
-  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(hpccg_comm, &size);
+  MPI_Comm_rank(hpccg_comm, &rank);
 
   //
   //  first post receives, these are immediate receives
@@ -88,7 +89,7 @@ void exchange_externals(HPC_Sparse_Matrix * A, const double *x)
     {
       int n_recv = recv_length[i];
       MPI_Irecv(x_external, n_recv, MPI_DOUBLE, neighbors[i], MPI_MY_TAG, 
-		MPI_COMM_WORLD, request+i);
+		hpccg_comm, request+i);
       x_external += n_recv;
     }
 
@@ -107,7 +108,7 @@ void exchange_externals(HPC_Sparse_Matrix * A, const double *x)
     {
       int n_send = send_length[i];
       MPI_Send(send_buffer, n_send, MPI_DOUBLE, neighbors[i], MPI_MY_TAG, 
-	       MPI_COMM_WORLD);
+	       hpccg_comm);
       send_buffer += n_send;
     }
 
@@ -115,6 +116,7 @@ void exchange_externals(HPC_Sparse_Matrix * A, const double *x)
   // Complete the reads issued above
   //
 
+  double t0 = mytimer();
   MPI_Status status;
   for (i = 0; i < num_neighbors; i++)
     {
@@ -124,6 +126,7 @@ void exchange_externals(HPC_Sparse_Matrix * A, const double *x)
 	  exit(-1);
 	}
     }
+  time_wait += mytimer() - t0;
 
   delete [] request;
 
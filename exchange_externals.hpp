@@ -46,5 +46,6 @@
 #include <mpi.h>
 #endif
 #include "HPC_Sparse_Matrix.hpp"
-void exchange_externals(HPC_Sparse_Matrix *A, const double *x);
+#include "mytimer.hpp"
+void exchange_externals(HPC_Sparse_Matrix *A, const double *x, double & time_wait);
 #endif
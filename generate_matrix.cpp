@@ -56,7 +56,50 @@ using std::endl;
 #include <cstdlib>
 #include <cstdio>
 #include <cassert>
+#ifdef USING_OMP
+#include <omp.h>
+#endif
 #include "generate_matrix.hpp"
+#include "tracked_memory.hpp"
+#include "hpccg_comm.hpp"
+// Computes row curlocalrow of the stencil.  Returns its number of
+// nonzeros, and if vals is not 0 also stores its values, column indices
+// and a pointer to its diagonal.
+static int generate_row(int nx, int ny, int curlocalrow, int start_row, int total_nrow,
+			bool use_7pt_stencil, double * vals, int * inds, double ** diag)
+{
+  int iy = (curlocalrow/nx)%ny;
+  int ix = curlocalrow%nx;
+  int currow = start_row+curlocalrow;
+  int nnzrow = 0;
+  for (int sz=-1; sz<=1; sz++) {
+    for (int sy=-1; sy<=1; sy++) {
+      for (int sx=-1; sx<=1; sx++) {
+	int curcol = currow+sz*nx*ny+sy*nx+sx;
+//      Since we have a stack of nx by ny by nz domains , stacking in the z direction, we check to see
+//      if sx and sy are reaching outside of the domain, while the check for the curcol being valid
+//      is sufficient to check the z values
+	if ((ix+sx>=0) && (ix+sx<nx) && (iy+sy>=0) && (iy+sy<ny) && (curcol>=0 && curcol<total_nrow)) {
+	  if (!use_7pt_stencil || (sz*sz+sy*sy+sx*sx<=1)) { // This logic will skip over point that are not part of a 7-pt stencil
+	    if (vals) {
+	      if (curcol==currow) {
+		*diag = vals+nnzrow;
+		vals[nnzrow] = 27.0;
+	      }
+	      else {
+		vals[nnzrow] = -1.0;
+	      }
+	      inds[nnzrow] = curcol;
+	    }
+	    nnzrow++;
+	  }
+	}
+      } // end sx loop
+    } // end sy loop
+  } // end sz loop
+  return(nnzrow);
+}
+
 void generate_matrix(int nx, int ny, int nz, HPC_Sparse_Matrix **A, double **x, double **b, double **xexact)
 
 {
@@ -68,15 +111,15 @@ void generate_matrix(int nx, int ny, int nz, HPC_Sparse_Matrix **A, double **x,
 
 #ifdef USING_MPI
   int size, rank; // Number of MPI processes, My process ID
-  MPI_Comm_size(MPI_COMM_WORLD, &size);
-  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(hpccg_comm, &size);
+  MPI_Comm_rank(hpccg_comm, &rank);
 #else
   int size = 1; // Serial case (not using MPI)
   int rank = 0;
 #endif
 
   *A = new HPC_Sparse_Matrix; // Allocate matrix struct and fill it
-  (*A)->title = 0;
+  initMatrix(*A);
 
 
   // Set this bool to true if you want a 7-pt stencil instead of a 27 pt stencil
@@ -94,63 +137,77 @@ void generate_matrix(int nx, int ny, int nz, HPC_Sparse_Matrix **A, double **x,
   
 
   // Allocate arrays that are of length local_nrow
-  (*A)->nnz_in_row = new int[local_nrow];
-  (*A)->ptr_to_vals_in_row = new double*[local_nrow];
-  (*A)->ptr_to_inds_in_row = new int   *[local_nrow];
-  (*A)->ptr_to_diags       = new double*[local_nrow];
+  (*A)->nnz_in_row = tracked_new<int>(local_nrow, MEM_ROW_METADATA);
+  (*A)->ptr_to_vals_in_row = tracked_new<double*>(local_nrow, MEM_ROW_METADATA);
+  (*A)->ptr_to_inds_in_row = tracked_new<int*>(local_nrow, MEM_ROW_METADATA);
+  (*A)->ptr_to_diags       = tracked_new<double*>(local_nrow, MEM_ROW_METADATA);
 
-  *x = new double[local_nrow];
-  *b = new double[local_nrow];
-  *xexact = new double[local_nrow];
+  *x = tracked_new<double>(local_nrow, MEM_VECTORS);
+  *b = tracked_new<double>(local_nrow, MEM_VECTORS);
+  *xexact = tracked_new<double>(local_nrow, MEM_VECTORS);
 
 
   // Allocate arrays that are of length local_nnz
-  (*A)->list_of_vals = new double[local_nnz];
-  (*A)->list_of_inds = new int   [local_nnz];
-
-  double * curvalptr = (*A)->list_of_vals;
-  int * curindptr = (*A)->list_of_inds;
-
-  long long nnzglobal = 0;
-  for (int iz=0; iz<nz; iz++) {
-    for (int iy=0; iy<ny; iy++) {
-      for (int ix=0; ix<nx; ix++) {
-	int curlocalrow = iz*nx*ny+iy*nx+ix;
-	int currow = start_row+iz*nx*ny+iy*nx+ix;
-	int nnzrow = 0;
-	(*A)->ptr_to_vals_in_row[curlocalrow] = curvalptr;
-	(*A)->ptr_to_inds_in_row[curlocalrow] = curindptr;
-	for (int sz=-1; sz<=1; sz++) {
-	  for (int sy=-1; sy<=1; sy++) {
-	    for (int sx=-1; sx<=1; sx++) {
-	      int curcol = currow+sz*nx*ny+sy*nx+sx;
-//            Since we have a stack of nx by ny by nz domains , stacking in the z direction, we check to see
-//            if sx and sy are reaching outside of the domain, while the check for the curcol being valid
-//            is sufficient to check the z values
-              if ((ix+sx>=0) && (ix+sx<nx) && (iy+sy>=0) && (iy+sy<ny) && (curcol>=0 && curcol<total_nrow)) {
-                if (!use_7pt_stencil || (sz*sz+sy*sy+sx*sx<=1)) { // This logic will skip over point that are not part of a 7-pt stencil
-                  if (curcol==currow) {
-		    (*A)->ptr_to_diags[curlocalrow] = curvalptr;
-		    *curvalptr++ = 27.0;
-		  }
-		  else {
-		    *curvalptr++ = -1.0;
-                  }
-		  *curindptr++ = curcol;
-		  nnzrow++;
-	        } 
-              }
-	    } // end sx loop
-          } // end sy loop
-        } // end sz loop
-	(*A)->nnz_in_row[curlocalrow] = nnzrow;
-	nnzglobal += nnzrow;
-	(*x)[curlocalrow] = 0.0;
-	(*b)[curlocalrow] = 27.0 - ((double) (nnzrow-1));
-	(*xexact)[curlocalrow] = 1.0;
-      } // end ix loop
-     } // end iy loop
-  } // end iz loop  
+  (*A)->list_of_vals = tracked_new<double>(local_nnz, MEM_VALUES);
+  (*A)->list_of_inds = tracked_new<int>(local_nnz, MEM_INDICES);
+
+  // Rows are generated in two passes over the same static OpenMP
+  // partition the kernels use, so each thread first touches, and the
+  // OS places near it, the rows it will later multiply.  The first pass
+  // counts each thread's nonzeros, the second fills its rows starting at
+  // the offset of the threads before it, giving the same layout as a
+  // serial loop.
+
+  int nthreads = 1;
+#ifdef USING_OMP
+  nthreads = omp_get_max_threads();
+#endif
+  long long * thread_offset = new long long[nthreads+1];
+  for (int t=0; t<=nthreads; t++) thread_offset[t] = 0;
+
+#ifdef USING_OMP
+#pragma omp parallel
+#endif
+  {
+    int thread = 0;
+#ifdef USING_OMP
+    thread = omp_get_thread_num();
+#endif
+    long long thread_nnz = 0;
+#ifdef USING_OMP
+#pragma omp for schedule(static)
+#endif
+    for (int curlocalrow=0; curlocalrow<local_nrow; curlocalrow++) {
+      int nnzrow = generate_row(nx, ny, curlocalrow, start_row, total_nrow, use_7pt_stencil, 0, 0, 0);
+      (*A)->nnz_in_row[curlocalrow] = nnzrow;
+      thread_nnz += nnzrow;
+    }
+    thread_offset[thread+1] = thread_nnz;
+#ifdef USING_OMP
+#pragma omp barrier
+#pragma omp single
+#endif
+    for (int t=0; t<nthreads; t++) thread_offset[t+1] += thread_offset[t];
+
+    double * curvalptr = (*A)->list_of_vals + thread_offset[thread];
+    int * curindptr = (*A)->list_of_inds + thread_offset[thread];
+#ifdef USING_OMP
+#pragma omp for schedule(static)
+#endif
+    for (int curlocalrow=0; curlocalrow<local_nrow; curlocalrow++) {
+      int nnzrow = (*A)->nnz_in_row[curlocalrow];
+      (*A)->ptr_to_vals_in_row[curlocalrow] = curvalptr;
+      (*A)->ptr_to_inds_in_row[curlocalrow] = curindptr;
+      generate_row(nx, ny, curlocalrow, start_row, total_nrow, use_7pt_stencil,
+		   curvalptr, curindptr, &(*A)->ptr_to_diags[curlocalrow]);
+      curvalptr += nnzrow;
+      curindptr += nnzrow;
+      (*x)[curlocalrow] = 0.0;
+      (*b)[curlocalrow] = 27.0 - ((double) (nnzrow-1));
+      (*xexact)[curlocalrow] = 1.0;
+    }
+  }
+  delete [] thread_offset;
   if (debug) cout << "Process "<<rank<<" of "<<size<<" has "<<local_nrow;
   
   if (debug) cout << " rows. Global rows "<< start_row
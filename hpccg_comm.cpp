@@ -40,9 +40,8 @@
 // ************************************************************************
 //@HEADER
 
-#ifndef DUMP_MATLAB_MATRIX_H
-#define DUMP_MATLAB_MATRIX_H
-#include "HPC_Sparse_Matrix.hpp"
+#ifdef USING_MPI
+#include "hpccg_comm.hpp"
 
-int dump_matlab_matrix( HPC_Sparse_Matrix *A, int rank);
+MPI_Comm hpccg_comm = MPI_COMM_WORLD;
 #endif
@@ -53,8 +53,10 @@
 
 // read_HPC_row - Reads in linear system
 
-// mytimer - Timing routine (compile with -DWALL to get wall clock
-//           times
+// read_matrix_market - Reads in a matrix in Matrix Market format
+
+// mytimer - Timing routine (monotonic wall clock by default, see
+//           mytimer.cpp for the alternatives)
 
 // HPCCG - CG Solver
 
@@ -65,27 +67,42 @@ using std::cout;
 using std::cerr;
 using std::endl;
 #include <cstdio>
+#include <unistd.h>
 #include <cstdlib>
 #include <cctype>
 #include <cassert>
+#include <cstring>
 #include <string>
 #include <cmath>
 #ifdef USING_MPI
 #include <mpi.h> // If this routine is compiled with -DUSING_MPI
                  // then include mpi.h
 #include "make_local_matrix.hpp" // Also include this function
+#include "partition_matrix.hpp"
+#include "rank_stats.hpp"
+#include "hpccg_comm.hpp"
 #endif
 #ifdef USING_OMP
 #include <omp.h>
 #endif
 #include "generate_matrix.hpp"
 #include "read_HPC_row.hpp"
+#include "read_matrix_market.hpp"
 #include "mytimer.hpp"
 #include "HPC_sparsemv.hpp"
 #include "compute_residual.hpp"
 #include "HPCCG.hpp"
+#include "tracked_memory.hpp"
 #include "HPC_Sparse_Matrix.hpp"
-#include "dump_matlab_matrix.hpp"
+#include "dump_matrix.hpp"
+#include "parse_options.hpp"
+#include "reorder_matrix.hpp"
+#include "roofline.hpp"
+#include "scaling_study.hpp"
+#include "sparsemv_simd.hpp"
+#include "mixed_precision.hpp"
+#include "autotune.hpp"
+#include "matrix_formats.hpp"
 
 #include "YAML_Element.hpp"
 #include "YAML_Doc.hpp"
@@ -101,16 +118,17 @@ int main(int argc, char *argv[])
   int ierr = 0;
   int i, j;
   int ione = 1;
-  double times[7];
+  double times[8];
   double t6 = 0.0;
   int nx,ny,nz;
+  int max_iter = 150;
 
 #ifdef USING_MPI
 
   MPI_Init(&argc, &argv);
   int size, rank; // Number of MPI processes, My process ID
-  MPI_Comm_size(MPI_COMM_WORLD, &size);
-  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(hpccg_comm, &size);
+  MPI_Comm_rank(hpccg_comm, &rank);
 
   //  if (size < 100) cout << "Process "<<rank<<" of "<<size<<" is alive." <<endl;
 
@@ -130,35 +148,175 @@ int main(int argc, char *argv[])
     cin >> junk;
    }
 
-  MPI_Barrier(MPI_COMM_WORLD);
+  MPI_Barrier(hpccg_comm);
 #endif
 
 
-  if(argc != 2 && argc!=4) {
+  HPCCG_Options options;
+  int nargs = parse_options(argc, argv, options);
+  tracked_set_huge_pages(options.huge_pages);
+  simd_select_isa(options.simd_isa);
+  sparsemv_fixed_width = options.fixed_width;
+
+  // The upper triangle holds the double values and replaces every
+  // other copy, so the float solve would repeat the double one
+  if (options.symmetric && options.float_values)
+    {
+      if (rank==0) cerr << "float_values=1 is not available with symmetric=1, disabling it" << endl;
+      options.float_values = 0;
+    }
+
+  // Without nx ny nz, a memory budget can size the generated problem
+  bool auto_sized = nargs==0 && (options.memory_fraction>0.0 || options.memory_per_rank>0);
+
+  if(nargs != 1 && nargs!=3 && !auto_sized) {
     if (rank==0)
       cerr << "Usage:" << endl
-	   << "Mode 1: " << argv[0] << " nx ny nz" << endl
+	   << "Mode 1: " << argv[0] << " nx ny nz [options]" << endl
 	   << "     where nx, ny and nz are the local sub-block dimensions, or" << endl
-	   << "Mode 2: " << argv[0] << " HPC_data_file " << endl
-	   << "     where HPC_data_file is a globally accessible file containing matrix data." << endl;
+	   << "Mode 2: " << argv[0] << " HPC_data_file [options]" << endl
+	   << "     where HPC_data_file is a globally accessible file containing matrix data" << endl
+	   << "     (Matrix Market format if the name ends in .mtx), or" << endl
+	   << "Mode 3: " << argv[0] << " memory_fraction=F|memory_per_rank=bytes [options]" << endl
+	   << "     where nx, ny and nz are chosen to fill the given share of memory." << endl;
+    if (rank==0) print_options_usage();
     exit(1);
   }
 
-  if (argc==4) 
+  long long memory_target = 0;
+  if (nargs==3)
+    {
+      nx = atoi(argv[1]);
+      ny = atoi(argv[2]);
+      nz = atoi(argv[3]);
+    }
+  else if (auto_sized)
+    {
+      memory_target = options.memory_per_rank;
+      if (memory_target==0)
+	memory_target = (long long) (options.memory_fraction*node_memory_per_rank());
+      if (memory_target==0 || !auto_size_problem(memory_target, size, options, nx, ny, nz))
+	{
+	  if (rank==0) cerr << "Cannot fit a problem in " << memory_target
+			    << " bytes per processor" << endl;
+	  exit(1);
+	}
+      nargs = 3; // Generate the chosen problem as if nx ny nz were given
+    }
+
+  // Where the results file goes
+
+  std::string results_dir = options.results_dir ? options.results_dir : "";
+  std::string results_file = options.results_file ? options.results_file : "";
+
+  // A scaling study replaces the single run
+
+  if (options.scaling)
+    {
+      if (nargs!=3)
+	{
+	  if (rank==0) cerr << "A scaling study requires nx ny nz or a memory budget" << endl;
+	  exit(1);
+	}
+      YAML_Doc doc("hpccg", "1.0", results_dir, results_file);
+      ierr = scaling_study(nx, ny, nz, options.scaling==2,
+			   options.scaling_ranks, max_iter, &doc);
+      if (rank==0 && ierr==0) doc.generate(cout, options.json);
+#ifdef USING_MPI
+      MPI_Finalize();
+#endif
+      return ierr;
+    }
+
+  // Estimate the memory a generated problem would need, without allocating it
+
+  if (options.dry_run)
+    {
+      if (nargs!=3)
+	{
+	  if (rank==0) cerr << "A dry run requires nx ny nz or a memory budget" << endl;
+	  exit(1);
+	}
+      long long estimate[mem_num_categories];
+      estimate_generated_memory(nx, ny, nz, size, options, estimate);
+      if (rank==0)
+	{
+	  YAML_Doc doc("hpccg", "1.0", results_dir, results_file);
+	  YAML_Element * section = doc.add("Memory Estimate","");
+	  section->add("nx",nx);
+	  section->add("ny",ny);
+	  section->add("nz",nz);
+	  if (memory_target) section->add("Memory target per processor",memory_target);
+	  section->add("Number of processors",size);
+	  // Processors at the ends of the stack have one neighbor, not two,
+	  // so the total is an upper bound
+	  YAML_Element * per_rank = section->add("Bytes per processor","");
+	  long long total = 0;
+	  for (int c=0; c<mem_num_categories; c++)
+	    {
+	      per_rank->add(mem_category_names[c],estimate[c]);
+	      total += estimate[c];
+	    }
+	  per_rank->add("Total",total);
+	  section->add("Bytes on all processors",total*size);
+	  doc.generate(cout, options.json);
+	}
+#ifdef USING_MPI
+      MPI_Finalize();
+#endif
+      return 0;
+    }
+
+  // Measure the memory bandwidth while the memory is still free
+
+  double stream_gbytes_per_sec = 0.0;
+  if (options.roofline && options.stream_size>0)
+    stream_gbytes_per_sec = stream_bandwidth(options.stream_size, 10);
+  if (options.peak_bandwidth==0.0) options.peak_bandwidth = stream_gbytes_per_sec;
+
+  if (nargs==3) 
   {
-    nx = atoi(argv[1]);
-    ny = atoi(argv[2]);
-    nz = atoi(argv[3]);
     generate_matrix(nx, ny, nz, &A, &x, &b, &xexact);
   }
   else
   {
-    read_HPC_row(argv[1], &A, &x, &b, &xexact);
+    size_t len = strlen(argv[1]);
+    if (len>4 && strcmp(argv[1]+len-4, ".mtx")==0)
+      read_matrix_market(argv[1], &A, &x, &b, &xexact);
+    else
+      read_HPC_row(argv[1], &A, &x, &b, &xexact);
   }
 
+#ifdef USING_MPI
+
+  // Rows of a file-read matrix are assigned in contiguous blocks, which
+  // can give huge halos if the file ordering is not local.  Redistribute
+  // them using a partition of the sparsity graph.
 
-  bool dump_matrix = false;
-  if (dump_matrix && size<=4) dump_matlab_matrix(A, rank);
+  bool partitioned = false;
+  long long edge_cut_before = 0, edge_cut_after = 0;
+  long long halo_volume_before = 0, halo_volume_after = 0;
+  double t_partition = 0.0;
+  if (nargs==1 && options.partition_graph && size>1)
+    {
+      t_partition = mytimer();
+      partition_matrix(A, &x, &b, &xexact, edge_cut_before, edge_cut_after,
+		       halo_volume_before, halo_volume_after);
+      t_partition = mytimer() - t_partition;
+      partitioned = true;
+    }
+#endif
+
+  // Write the matrix while it still has global indices
+
+  long long dump_bytes = 0;
+  double t_dump = 0.0;
+  if (options.dump_file)
+    {
+      t_dump = mytimer();
+      if (dump_matrix(A, x, b, xexact, options.dump_file, dump_bytes)) options.dump_file = 0;
+      t_dump = mytimer() - t_dump;
+    }
 
 #ifdef USING_MPI
 
@@ -170,24 +328,232 @@ int main(int argc, char *argv[])
 
 #endif
 
+  // Specialize HPC_sparsemv for the matrix's row width
+  sparsemv_setup(A);
+
+  // Optionally renumber the local rows to improve the locality of the
+  // x accesses in HPC_sparsemv.  The Morton curve needs the grid
+  // dimensions, so it is only available for generated matrices.
+
+  int * new_to_old = 0;
+  int bandwidth_before = 0, bandwidth_after = 0;
+  double spmv_time_before = 0.0, spmv_time_after = 0.0;
+  if (options.reorder_rows)
+    {
+      if (options.reorder_rows==2 && nargs!=3)
+	{
+	  if (rank==0) cerr << "Morton reordering requires a generated matrix, using RCM" << endl;
+	  options.reorder_rows = 1;
+	}
+      new_to_old = new int[A->local_nrow];
+      if (options.reorder_rows==2) morton_ordering(nx, ny, nz, new_to_old);
+      else rcm_ordering(A, new_to_old);
+
+      bandwidth_before = matrix_bandwidth(A);
+      spmv_time_before = time_sparsemv(A, 10);
+      reorder_matrix(A, new_to_old);
+      permute_vector(A->local_nrow, new_to_old, x);
+      permute_vector(A->local_nrow, new_to_old, b);
+      permute_vector(A->local_nrow, new_to_old, xexact);
+      bandwidth_after = matrix_bandwidth(A);
+      spmv_time_after = time_sparsemv(A, 10);
+#ifdef USING_MPI
+      int bandwidths[2] = {bandwidth_before, bandwidth_after};
+      int max_bandwidths[2];
+      MPI_Allreduce(bandwidths, max_bandwidths, 2, MPI_INT, MPI_MAX, hpccg_comm);
+      bandwidth_before = max_bandwidths[0];
+      bandwidth_after = max_bandwidths[1];
+      double spmv_times[2] = {spmv_time_before, spmv_time_after};
+      double max_spmv_times[2];
+      MPI_Allreduce(spmv_times, max_spmv_times, 2, MPI_DOUBLE, MPI_MAX, hpccg_comm);
+      spmv_time_before = max_spmv_times[0];
+      spmv_time_after = max_spmv_times[1];
+#endif
+    }
+
+  // Optionally time the ways HPC_sparsemv can run on the final matrix
+  // and keep the fastest.  The format options below still apply on top.
+
+  HPCCG_Tuning tuning;
+  if (options.tune)
+    tune_sparsemv(A, options.tune==2, options.tune_file, tuning);
+
+  // Optionally keep copies of the matrix in other formats, which
+  // HPC_sparsemv then reads: 16-bit indices where they fit, codes into
+  // a table of the distinct values if there are few enough, float
+  // values, dense blocks if some block size stores A in fewer bytes,
+  // and the upper triangle if A is symmetric, which then replaces the
+  // rows and all the other copies.  SPARSEMV is timed before and after
+  // each.
+
+  const int format_options[num_matrix_formats] =
+    {options.short_indices, options.value_codes, options.float_values, options.bcsr,
+     options.symmetric};
+  Format_Result formats[num_matrix_formats];
+  int num_formats = 0;
+  const Format_Result * float_format = 0;
+  for (i=0; i<num_matrix_formats; i++)
+    if (format_options[i])
+      {
+	add_matrix_format(A, i, formats[num_formats]);
+	if (i==FORMAT_FLOAT_VALUES) float_format = &formats[num_formats];
+	num_formats++;
+      }
+
+  // The refinement steps each start a new solve, which checkpoints and
+  // the trace do not follow
+  if (options.refine && (options.checkpoint_interval>0 || options.restart || options.trace))
+    {
+      if (rank==0) cerr << "Checkpointing and tracing are not available with refine=1, disabling them" << endl;
+      options.checkpoint_interval = 0;
+      options.restart = 0;
+      options.trace = 0;
+      options.trace_file = 0;
+    }
+
   double t1 = mytimer();   // Initialize it (if needed)
   int niters = 0;
   double normr = 0.0;
-  int max_iter = 150;
-  double tolerance = 0.0; // Set tolerance to zero to make all runs do max_iter iterations
-  ierr = HPCCG( A, b, x, max_iter, tolerance, niters, normr, times);
+  double tolerance = options.tolerance; // Zero makes all runs do max_iter iterations
+  HPCCG_Checkpoint checkpoint;
+  checkpoint_init(&checkpoint, options.checkpoint_interval, options.checkpoint_prefix,
+		  options.restart);
+  bool checkpointing = options.checkpoint_interval>0 || options.restart;
+  HPCCG_Trace trace;
+  if (options.trace) trace_init(&trace, max_iter);
+  HPCCG_Counters counters;
+  if (options.counters) counters_init(&counters);
+
+  // Initial guess of the comparison solve with the double values below
+  double * x_double = 0;
+  if (options.float_values)
+    {
+      x_double = tracked_new_vector(A->local_nrow);
+      for (i=0; i<A->local_nrow; i++) x_double[i] = x[i];
+    }
+
+  int refine_steps = 0;
+  double refine_residual_time = 0.0;
+  if (options.refine)
+    ierr = HPCCG_refine(A, b, x, max_iter, tolerance, niters, normr, times,
+			refine_steps, refine_residual_time, options.counters ? &counters : 0);
+  else
+    ierr = HPCCG( A, b, x, max_iter, tolerance, niters, normr, times,
+		  checkpointing ? &checkpoint : 0, options.trace ? &trace : 0,
+		  options.counters ? &counters : 0);
 
 	if (ierr) cerr << "Error in call to CG: " << ierr << ".\n" << endl;
 
+  // With float values, the convergence cost is measured against plain
+  // CG with the double values from the same initial guess.  Without
+  // refinement the CG residual is that of the float matrix, so the
+  // residual is also recomputed with the double values.
+
+  double float_residual = normr;
+  int double_niters = 0;
+  double double_normr = 0.0, double_time = 0.0;
+  if (options.float_values)
+    {
+      if (!options.refine) float_residual = residual_norm(A, b, x);
+      if (rank==0) cout << "Solving again with the double values" << endl;
+      double double_times[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+      float ** float_vals = A->ptr_to_float_vals_in_row;
+      A->ptr_to_float_vals_in_row = 0;
+      HPCCG(A, b, x_double, max_iter, tolerance, double_niters, double_normr, double_times);
+      A->ptr_to_float_vals_in_row = float_vals;
+      double_time = double_times[0];
+      tracked_delete(x_double);
+    }
+
+  // Return the solution to the original row numbering
+  if (new_to_old)
+    {
+      unpermute_vector(A->local_nrow, new_to_old, x);
+      unpermute_vector(A->local_nrow, new_to_old, xexact);
+      delete [] new_to_old;
+      new_to_old = 0;
+    }
+
 #ifdef USING_MPI
       double t4 = times[4];
       double t4min = 0.0;
       double t4max = 0.0;
       double t4avg = 0.0;
-      MPI_Allreduce(&t4, &t4min, 1, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
-      MPI_Allreduce(&t4, &t4max, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
-      MPI_Allreduce(&t4, &t4avg, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+      MPI_Allreduce(&t4, &t4min, 1, MPI_DOUBLE, MPI_MIN, hpccg_comm);
+      MPI_Allreduce(&t4, &t4max, 1, MPI_DOUBLE, MPI_MAX, hpccg_comm);
+      MPI_Allreduce(&t4, &t4avg, 1, MPI_DOUBLE, MPI_SUM, hpccg_comm);
       t4avg = t4avg/((double) size);
+
+      // Per-rank times and communication volume, for the imbalance report
+      HPCCG_Rank_Stats rank_stats;
+      gather_rank_stats(A, times, rank_stats);
+#endif
+
+  // Summarize the trace over iterations and processors, and optionally
+  // write all of it.  All processors are needed here.
+
+  double trace_stats[trace_num_kernels][trace_num_stats];
+  if (options.trace)
+    {
+      trace_statistics(&trace, niters, trace_stats);
+      if (options.trace_file && trace_write_chrome(&trace, options.trace_file))
+	options.trace_file = 0;
+      trace_destroy(&trace);
+    }
+
+  long long counter_totals[trace_num_kernels][counters_num_events];
+  bool counter_available[counters_num_events];
+  if (options.counters)
+    {
+      counters_summary(&counters, counter_totals, counter_available);
+      counters_destroy(&counters);
+    }
+
+  double bytes_ddot = 0.0, bytes_waxpby = 0.0, bytes_sparsemv = 0.0;
+  if (stream_gbytes_per_sec>0.0)
+    {
+      min_traffic(A, bytes_ddot, bytes_waxpby, bytes_sparsemv);
+      bytes_ddot *= niters;
+      bytes_waxpby *= niters;
+      bytes_sparsemv *= niters;
+    }
+
+  // Instruction set of each processor's SPARSEMV, which can differ on a
+  // mixed cluster
+
+  int isa_ranks[simd_num_isas];
+  for (i=0; i<simd_num_isas; i++) isa_ranks[i] = i==simd_isa ? 1 : 0;
+#ifdef USING_MPI
+  int isa_ranks_local[simd_num_isas];
+  for (i=0; i<simd_num_isas; i++) isa_ranks_local[i] = isa_ranks[i];
+  MPI_Allreduce(isa_ranks_local, isa_ranks, simd_num_isas, MPI_INT, MPI_SUM, hpccg_comm);
+#endif
+
+  // High-water marks of the tracked allocations and of the whole process
+
+  long long memory_peaks[mem_num_categories+2];
+  for (i=0; i<mem_num_categories; i++) memory_peaks[i] = memory_peak(i);
+  memory_peaks[mem_num_categories] = memory_peak_total();
+  memory_peaks[mem_num_categories+1] = memory_peak_rss();
+#ifdef USING_MPI
+  long long memory_max[mem_num_categories+2], memory_sum[mem_num_categories+2];
+  MPI_Allreduce(memory_peaks, memory_max, mem_num_categories+2, MPI_LONG_LONG, MPI_MAX, hpccg_comm);
+  MPI_Allreduce(memory_peaks, memory_sum, mem_num_categories+2, MPI_LONG_LONG, MPI_SUM, hpccg_comm);
+#else
+  long long * memory_max = memory_peaks, * memory_sum = memory_peaks;
+#endif
+
+  // Bytes on each kind of page over all processors, and how many of
+  // those advised for transparent huge pages the kernel really backed
+  long long thp_in_use = memory_transparent_huge_pages();
+  long long page_totals[page_num_kinds+1];
+  for (i=0; i<page_num_kinds; i++) page_totals[i] = memory_pages(i);
+  page_totals[page_num_kinds] = thp_in_use>0 ? thp_in_use : 0;
+#ifdef USING_MPI
+  long long page_sums[page_num_kinds+1];
+  MPI_Allreduce(page_totals, page_sums, page_num_kinds+1, MPI_LONG_LONG, MPI_SUM, hpccg_comm);
+#else
+  long long * page_sums = page_totals;
 #endif
 
 // initialize YAML doc
@@ -202,7 +568,7 @@ int main(int argc, char *argv[])
       double fnops_sparsemv = fniters*2*fnnz;
       double fnops = fnops_ddot+fnops_waxpby+fnops_sparsemv;
 
-      YAML_Doc doc("hpccg", "1.0");
+      YAML_Doc doc("hpccg", "1.0", results_dir, results_file);
 
       doc.add("Parallelism","");
 
@@ -221,15 +587,189 @@ int main(int argc, char *argv[])
           doc.get("Parallelism")->add("OpenMP not enabled","");
 #endif
 
+      YAML_Element * simd = doc.add("SIMD","");
+      simd->add("SPARSEMV instruction set",simd_isa_names[simd_isa]);
+      simd->add("Best supported",simd_isa_names[simd_detect_isa()]);
+      simd->add("Fixed row width",A->row_width);
+      for (i=0; i<simd_num_isas; i++)
+	if (isa_ranks[i]>0 && isa_ranks[i]<size)
+	  simd->add(std::string("Ranks using ")+simd_isa_names[i],isa_ranks[i]);
+
+      doc.add("Timer","");
+      doc.get("Timer")->add("Backend",mytimer_name());
+      doc.get("Timer")->add("Resolution",mytimer_resolution());
+
       doc.add("Dimensions","");
 	  doc.get("Dimensions")->add("nx",nx);
 	  doc.get("Dimensions")->add("ny",ny);
 	  doc.get("Dimensions")->add("nz",nz);
-
-
+      if (memory_target) {
+        doc.get("Dimensions")->add("Sizing",options.memory_per_rank ? "memory_per_rank" : "memory_fraction");
+        if (!options.memory_per_rank)
+          doc.get("Dimensions")->add("Memory fraction",options.memory_fraction);
+        doc.get("Dimensions")->add("Memory target per processor",memory_target);
+      }
+
+
+
+      if (options.reorder_rows) {
+        doc.add("Local Reordering","");
+        doc.get("Local Reordering")->add("Ordering",options.reorder_rows==2 ? "Morton" : "RCM");
+        doc.get("Local Reordering")->add("Bandwidth before",bandwidth_before);
+        doc.get("Local Reordering")->add("Bandwidth after",bandwidth_after);
+        doc.get("Local Reordering")->add("SPARSEMV time before",spmv_time_before);
+        doc.get("Local Reordering")->add("SPARSEMV time after",spmv_time_after);
+        doc.get("Local Reordering")->add("SPARSEMV speedup",spmv_time_before/spmv_time_after);
+      }
+
+      if (options.tune) {
+        YAML_Element * tuned = doc.add("SPARSEMV Tuning","");
+        tuned->add("Key",tuning.key);
+        tuned->add("Cache file",options.tune_file ? options.tune_file : "none");
+        tuned->add("Choice from cache",tuning.from_cache ? "yes" : "no");
+        tuned->add("Choice",tuning.choice_name);
+        tuned->add("Instruction set",simd_isa_names[tuning.choice.isa]);
+        tuned->add("Row width",tuning.choice.row_width);
+        tuned->add("Value codes",tuning.choice.value_codes);
+        tuned->add("16-bit indices",tuning.choice.short_indices);
+        tuned->add("Blocks",tuning.choice.blocks);
+        tuned->add("Symmetric",tuning.choice.symmetric);
+        tuned->add("Dynamic chunk",tuning.choice.chunk);
+        tuned->add("Tuning time",tuning.tuning_time);
+        tuned->add("SPARSEMV time before",tuning.default_time);
+        tuned->add("SPARSEMV time after",tuning.choice_time);
+        tuned->add("SPARSEMV speedup",tuning.default_time/tuning.choice_time);
+        if (tuning.num_candidates>0) {
+          YAML_Element * candidates = tuned->add("Candidate times","");
+          for (int c=0; c<tuning.num_candidates; c++)
+            candidates->add(tuning.candidate_names[c],tuning.candidate_times[c]);
+        }
+      }
+
+      for (i=0; i<num_formats; i++) add_format_report(&doc, formats[i]);
+
+      if (options.dump_file) {
+        doc.add("Matrix Dump","");
+        doc.get("Matrix Dump")->add("File",options.dump_file);
+        doc.get("Matrix Dump")->add("Bytes",dump_bytes);
+        doc.get("Matrix Dump")->add("Time",t_dump);
+        doc.get("Matrix Dump")->add("MB/s",((double) dump_bytes)/t_dump/1.0E6);
+      }
+
+      // Peaks are per processor; the max is what must fit in a node's
+      // share of memory, the sum is the footprint of the whole job
+      YAML_Element * memory = doc.add("Memory","");
+      YAML_Element * memory_rank = memory->add("Max peak bytes per processor","");
+      YAML_Element * memory_all = memory->add("Sum of peak bytes","");
+      for (i=0; i<mem_num_categories; i++)
+	{
+	  memory_rank->add(mem_category_names[i],memory_max[i]);
+	  memory_all->add(mem_category_names[i],memory_sum[i]);
+	}
+      memory_rank->add("Tracked total",memory_max[mem_num_categories]);
+      memory_all->add("Tracked total",memory_sum[mem_num_categories]);
+      memory_rank->add("Peak RSS",memory_max[mem_num_categories+1]);
+      memory_all->add("Peak RSS",memory_sum[mem_num_categories+1]);
+
+      // The page size is that of the kind holding the most tracked bytes
+      int main_pages = PAGES_BASE;
+      for (i=0; i<page_num_kinds; i++)
+	if (page_sums[i]>page_sums[main_pages]) main_pages = i;
+      char page_size[64];
+      if (main_pages==PAGES_BASE)
+	sprintf(page_size, "%ld KB", sysconf(_SC_PAGESIZE)/1024);
+      else
+	sprintf(page_size, "%d MB (%s)", (int) (huge_page_size>>20),
+		main_pages==PAGES_EXPLICIT ? "explicit" : "transparent");
+      YAML_Element * pages = memory->add("Pages","");
+      pages->add("Page size",page_size);
+      for (i=0; i<page_num_kinds; i++)
+	pages->add(page_kind_names[i],page_sums[i]);
+      if (thp_in_use>=0)
+	pages->add("Transparent huge pages in use",page_sums[page_num_kinds]);
 
       doc.add("Number of iterations", niters);
       doc.add("Final residual", normr);
+      if (options.float_values || options.refine) {
+        YAML_Element * precision = doc.add("Mixed Precision","");
+        precision->add("Matrix values",options.float_values ? "float" : "double");
+        if (options.float_values) {
+          precision->add("Max relative rounding error",float_format->stats[0]);
+          precision->add("SPARSEMV time double",float_format->time_before);
+          precision->add("SPARSEMV time float",float_format->time_after);
+          precision->add("SPARSEMV speedup",float_format->time_before/float_format->time_after);
+        }
+        if (options.refine) {
+          precision->add("Refinement steps",refine_steps);
+          precision->add("Residual time",refine_residual_time);
+        }
+        if (options.float_values) {
+          precision->add("Residual with double values",float_residual);
+          YAML_Element * reference = precision->add("Double-precision solve","");
+          reference->add("Number of iterations",double_niters);
+          reference->add("Final residual",double_normr);
+          reference->add("Total time",double_time);
+          precision->add("Extra iterations",niters-double_niters);
+          precision->add("Solve speedup",double_time/times[0]);
+        }
+      }
+      if (checkpointing) {
+        doc.add("Checkpointing","");
+        doc.get("Checkpointing")->add("Interval",checkpoint.interval);
+        doc.get("Checkpointing")->add("Restarted from iteration",checkpoint.restart_iteration);
+        doc.get("Checkpointing")->add("Checkpoints written",checkpoint.num_written);
+        doc.get("Checkpointing")->add("Overhead time",checkpoint.overhead_time);
+        doc.get("Checkpointing")->add("Overhead pct",checkpoint.overhead_time/times[0]*100.0);
+      }
+      if (options.trace) {
+        doc.add("Iteration Trace","");
+        if (options.trace_file) doc.get("Iteration Trace")->add("File",options.trace_file);
+        for (int kernel=0; kernel<trace_num_kernels; kernel++) {
+          if (trace_stats[kernel][TRACE_MAX]==0.0) continue; // Not called in this build
+          YAML_Element * element = doc.get("Iteration Trace")->add(trace_kernel_names[kernel],"");
+          element->add("Min",trace_stats[kernel][TRACE_MIN]);
+          element->add("Median",trace_stats[kernel][TRACE_MEDIAN]);
+          element->add("P99",trace_stats[kernel][TRACE_P99]);
+          element->add("Max",trace_stats[kernel][TRACE_MAX]);
+          element->add("Worst iteration",(int) trace_stats[kernel][TRACE_WORST_ITERATION]);
+          element->add("Slowest rank",(int) trace_stats[kernel][TRACE_SLOWEST_RANK]);
+          element->add("Slowest rank total time",trace_stats[kernel][TRACE_SLOWEST_RANK_TIME]);
+        }
+      }
+      if (options.counters) {
+        // Memory traffic is estimated from last level cache misses, which
+        // leaves out write-backs and prefetches that hit in the LLC.
+        doc.add("Hardware Counters","");
+        YAML_Element * section = doc.get("Hardware Counters");
+        if (!counter_available[COUNTER_CYCLES])
+          section->add("Not available",counters.error ? counters.error : "Missing on some processors");
+        double kernel_times[trace_num_kernels] = {times[1], times[2], times[3], 0.0, 0.0};
+        double kernel_flops[trace_num_kernels] = {fnops_ddot, fnops_waxpby, fnops_sparsemv, 0.0, 0.0};
+#ifdef USING_MPI
+        kernel_times[TRACE_EXCHANGE] = times[5];
+#endif
+        for (int kernel=0; kernel<trace_num_kernels && counter_available[COUNTER_CYCLES]; kernel++) {
+          long long * total = counter_totals[kernel];
+          if (kernel_times[kernel]==0.0 || total[COUNTER_CYCLES]==0) continue;
+          YAML_Element * element = section->add(trace_kernel_names[kernel],"");
+          for (int event=0; event<counters_num_events; event++)
+            if (counter_available[event]) element->add(counter_event_names[event],total[event]);
+          if (counter_available[COUNTER_INSTRUCTIONS])
+            element->add("IPC",((double) total[COUNTER_INSTRUCTIONS])/total[COUNTER_CYCLES]);
+          if (counter_available[COUNTER_LLC_REFERENCES] && counter_available[COUNTER_LLC_MISSES]
+              && total[COUNTER_LLC_REFERENCES]>0)
+            element->add("LLC miss pct",100.0*total[COUNTER_LLC_MISSES]/total[COUNTER_LLC_REFERENCES]);
+          if (counter_available[COUNTER_LLC_MISSES]) {
+            double bytes = ((double) total[COUNTER_LLC_MISSES])*counters.line_size;
+            double gbytes_per_sec = bytes/kernel_times[kernel]/1.0E9;
+            element->add("Memory bytes (est.)",bytes);
+            if (kernel_flops[kernel]>0.0) element->add("Bytes per flop",bytes/kernel_flops[kernel]);
+            element->add("Memory GB/s (est.)",gbytes_per_sec);
+            if (options.peak_bandwidth>0.0)
+              element->add("Pct of peak bandwidth",100.0*gbytes_per_sec/options.peak_bandwidth);
+          }
+        }
+      }
       doc.add("#********** Performance Summary (times in sec) ***********","");
  
       doc.add("Time Summary","");
@@ -250,6 +790,27 @@ int main(int argc, char *argv[])
       doc.get("MFLOPS Summary")->add("WAXPBY  ",fnops_waxpby/times[2]/1.0E6);
       doc.get("MFLOPS Summary")->add("SPARSEMV",fnops_sparsemv/(times[3])/1.0E6);
 
+      if (stream_gbytes_per_sec>0.0) {
+        // The roof is the flop rate the memory system allows at each
+        // kernel's arithmetic intensity, using the minimum traffic.
+        doc.add("Roofline","");
+        doc.get("Roofline")->add("STREAM triad GB/s",stream_gbytes_per_sec);
+        const char * names[3] = {"DDOT", "WAXPBY", "SPARSEMV"};
+        double kernel_bytes[3] = {bytes_ddot, bytes_waxpby, bytes_sparsemv};
+        double kernel_flops[3] = {fnops_ddot, fnops_waxpby, fnops_sparsemv};
+        double kernel_times[3] = {times[1], times[2], times[3]};
+        for (int i=0; i<3; i++) {
+          double intensity = kernel_flops[i]/kernel_bytes[i];
+          double gbytes_per_sec = kernel_bytes[i]/kernel_times[i]/1.0E9;
+          YAML_Element * element = doc.get("Roofline")->add(names[i],"");
+          element->add("Min bytes",kernel_bytes[i]);
+          element->add("Flops per byte",intensity);
+          element->add("Achieved GB/s",gbytes_per_sec);
+          element->add("Roofline MFLOPS",intensity*stream_gbytes_per_sec*1.0E3);
+          element->add("Pct of roofline",100.0*gbytes_per_sec/stream_gbytes_per_sec);
+        }
+      }
+
 #ifdef USING_MPI
       doc.add("DDOT Timing Variations","");
       doc.get("DDOT Timing Variations")->add("Min DDOT MPI_Allreduce time",t4min);
@@ -265,13 +826,29 @@ int main(int argc, char *argv[])
       doc.get("SPARSEMV OVERHEADS")->add("SPARSEMV PARALLEL OVERHEAD Setup Pct", (times[6])/totalSparseMVTime*100.0);
       doc.get("SPARSEMV OVERHEADS")->add("SPARSEMV PARALLEL OVERHEAD Bdry Exch Time", (times[5]));
       doc.get("SPARSEMV OVERHEADS")->add("SPARSEMV PARALLEL OVERHEAD Bdry Exch Pct", (times[5])/totalSparseMVTime*100.0);
+
+      // Every rank is listed for up to 64 ranks, otherwise only summaries
+      YAML_Element * imbalance = doc.add("Load Imbalance","");
+      YAML_Element * comm_matrix = doc.add("Communication Matrix (bytes per exchange)","");
+      add_rank_stats(imbalance, comm_matrix, rank_stats, 64);
+
+      if (partitioned) {
+        doc.add("Graph Partitioning","");
+        doc.get("Graph Partitioning")->add("Edge cut before",edge_cut_before);
+        doc.get("Graph Partitioning")->add("Edge cut after",edge_cut_after);
+        doc.get("Graph Partitioning")->add("Halo volume before",halo_volume_before);
+        doc.get("Graph Partitioning")->add("Halo volume after",halo_volume_after);
+        doc.get("Graph Partitioning")->add("Partitioning time",t_partition);
+      }
 #endif
   
       if (rank == 0) { // only PE 0 needs to compute and report timing results
-        std::string yaml = doc.generateYAML();
-        cout << yaml;
+        doc.generate(cout, options.json);
        }
     }
+#ifdef USING_MPI
+  free_rank_stats(rank_stats);
+#endif
 
   // Compute difference between known exact solution and computed solution
   // All processors are needed here.
@@ -53,6 +53,8 @@ using std::endl;
 #include "HPC_Sparse_Matrix.hpp"
 #include "read_HPC_row.hpp"
 #include "make_local_matrix.hpp"
+#include "tracked_memory.hpp"
+#include "hpccg_comm.hpp"
 #include "mytimer.hpp"
 //#define DEBUG
 void make_local_matrix(HPC_Sparse_Matrix * A)
@@ -72,8 +74,8 @@ void make_local_matrix(HPC_Sparse_Matrix * A)
   // Get MPI process info
 
   int size, rank; // Number of MPI processes, My process ID
-  MPI_Comm_size(MPI_COMM_WORLD, &size);
-  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(hpccg_comm, &size);
+  MPI_Comm_rank(hpccg_comm, &rank);
 
   
   // Extract Matrix pieces
@@ -108,8 +110,8 @@ void make_local_matrix(HPC_Sparse_Matrix * A)
 
   if (debug) t0 = mytimer();
 
-  int *external_index = new int[max_external];
-  int *external_local_index = new int[max_external];
+  int *external_index = tracked_new<int>(max_external, MEM_COMM_BUFFERS);
+  int *external_local_index = tracked_new<int>(max_external, MEM_COMM_BUFFERS);
   A->external_index = external_index;
   A->external_local_index = external_local_index;
 
@@ -183,7 +185,7 @@ void make_local_matrix(HPC_Sparse_Matrix * A)
   //        will work...
 
   MPI_Allreduce(tmp_buffer, global_index_offsets, size, MPI_INT,
-		MPI_SUM, MPI_COMM_WORLD);
+		MPI_SUM, hpccg_comm);
 
   // Go through list of externals and find the processor that owns each
   int * external_processor = new int[num_external];
@@ -303,7 +305,7 @@ void make_local_matrix(HPC_Sparse_Matrix * A)
   /// sum over all processors all the tmp_neighbors arrays ///
 
   MPI_Allreduce(tmp_neighbors, tmp_buffer, size, MPI_INT, MPI_SUM, 
-		MPI_COMM_WORLD);
+		hpccg_comm);
 
   /// decode the combined 'tmp_neighbors' (stored in tmp_buffer) 
   //  array from all the processors
@@ -350,7 +352,7 @@ void make_local_matrix(HPC_Sparse_Matrix * A)
   if (debug) cout << "Processor " << rank << " of " << size <<
 	       ": Total number of elements to send = " << total_to_be_sent << endl;
 
-  if (debug) MPI_Barrier(MPI_COMM_WORLD);
+  if (debug) MPI_Barrier(hpccg_comm);
 
   /////////////////////////////////////////////////////////////////////////
   ///
@@ -359,7 +361,7 @@ void make_local_matrix(HPC_Sparse_Matrix * A)
   ///
   /////////////////////////////////////////////////////////////////////////
 
-  int * recv_list = new int[max_external];
+  int * recv_list = tracked_new<int>(max_external, MEM_COMM_BUFFERS);
 
   j = 0;
   recv_list[j++] = new_external_processor[0];
@@ -387,14 +389,14 @@ void make_local_matrix(HPC_Sparse_Matrix * A)
   for (i = 0; i < num_send_neighbors; i++) 
     {
       MPI_Irecv(tmp_buffer+i, 1, MPI_INT, MPI_ANY_SOURCE, MPI_MY_TAG, 
-		MPI_COMM_WORLD, request+i);
+		hpccg_comm, request+i);
     }
 
   // send messages 
 
   for (i = 0; i < num_recv_neighbors; i++) 
       MPI_Send(tmp_buffer+i, 1, MPI_INT, recv_list[i], MPI_MY_TAG, 
-	       MPI_COMM_WORLD);
+	       hpccg_comm);
   ///
    // Receive message from each send neighbor to construct 'send_list'.
    ///
@@ -454,7 +456,7 @@ void make_local_matrix(HPC_Sparse_Matrix * A)
   /////////////////////////////////////////////////////////////////////////
 
   A->total_to_be_sent = total_to_be_sent;
-  int * elements_to_send = new int[total_to_be_sent];
+  int * elements_to_send = tracked_new<int>(total_to_be_sent, MEM_COMM_BUFFERS);
   A->elements_to_send = elements_to_send;
 
   for (i = 0 ; i < total_to_be_sent; i++ ) elements_to_send[i] = 0;
@@ -485,13 +487,13 @@ void make_local_matrix(HPC_Sparse_Matrix * A)
   for (i = 0; i < num_recv_neighbors; i++) 
     {
       int partner    = recv_list[i];
-      MPI_Irecv(lengths+i, 1, MPI_INT, partner, MPI_MY_TAG, MPI_COMM_WORLD, 
+      MPI_Irecv(lengths+i, 1, MPI_INT, partner, MPI_MY_TAG, hpccg_comm, 
 		request+i);
     }
 
-  int * neighbors = new int[max_num_neighbors];
-  int * recv_length = new int[max_num_neighbors];		
-  int * send_length = new int[max_num_neighbors];
+  int * neighbors = tracked_new<int>(max_num_neighbors, MEM_COMM_BUFFERS);
+  int * recv_length = tracked_new<int>(max_num_neighbors, MEM_COMM_BUFFERS);		
+  int * send_length = tracked_new<int>(max_num_neighbors, MEM_COMM_BUFFERS);
 
   A->neighbors = neighbors;
   A->recv_length = recv_length;
@@ -518,7 +520,7 @@ void make_local_matrix(HPC_Sparse_Matrix * A)
       neighbors[i]  = recv_list[i];
       
       length = j - start;
-      MPI_Send(&length, 1, MPI_INT, recv_list[i], MPI_MY_TAG, MPI_COMM_WORLD);
+      MPI_Send(&length, 1, MPI_INT, recv_list[i], MPI_MY_TAG, hpccg_comm);
     }
 
   // Complete the receives of the number of externals
@@ -546,7 +548,7 @@ void make_local_matrix(HPC_Sparse_Matrix * A)
   for (i = 0; i < num_recv_neighbors; i++)
     {
       MPI_Irecv(elements_to_send+j, send_length[i], MPI_INT, neighbors[i], 
-		MPI_MY_TAG, MPI_COMM_WORLD, request+i);
+		MPI_MY_TAG, hpccg_comm, request+i);
       j += send_length[i];
     }
 
@@ -568,7 +570,7 @@ void make_local_matrix(HPC_Sparse_Matrix * A)
 	if (j == num_external) break;
       }
       MPI_Send(new_external+start, j-start, MPI_INT, recv_list[i], 
-	       MPI_MY_TAG, MPI_COMM_WORLD);
+	       MPI_MY_TAG, hpccg_comm);
     }
 
   // receive from each neighbor the global index list of external elements
@@ -595,12 +597,12 @@ void make_local_matrix(HPC_Sparse_Matrix * A)
   A->local_ncol = A->local_nrow + num_external;
 
   //Used in exchange_externals
-  double *send_buffer = new double[total_to_be_sent];
+  double *send_buffer = tracked_new<double>(total_to_be_sent, MEM_COMM_BUFFERS);
   A->send_buffer = send_buffer;
 
   delete [] tmp_buffer;
   delete [] global_index_offsets;
-  delete [] recv_list;
+  tracked_delete(recv_list);
   delete [] external_processor;
   delete [] new_external;
   delete [] new_external_processor;
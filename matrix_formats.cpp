@@ -0,0 +1,319 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Routines to make the optional copies of the matrix that HPC_sparsemv
+// reads, and report what each saves.
+
+// add_matrix_format - Times SPARSEMV, makes one copy, times it again,
+//                     and reduces the copy's statistics over the
+//                     processors.  Each format is a make function that
+//                     fills the statistics on one processor, the number
+//                     of them that are summed and then maxed, and a
+//                     report function that fills its section.
+
+// The sections give two kinds of bytes.  "SPARSEMV bytes" are what one
+// SPARSEMV call reads, which is what a copy saves when the kernel is
+// memory bound.  "Matrix memory" is the tracked matrix footprint before
+// and after the copy is made: the rows are kept, so a copy adds to the
+// footprint even when SPARSEMV reads fewer bytes, except for the upper
+// triangle, which replaces the rows and all other copies.
+
+/////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+using std::cerr;
+using std::endl;
+#ifdef USING_MPI
+#include <mpi.h>
+#include "hpccg_comm.hpp"
+#endif
+#include "matrix_formats.hpp"
+#include "HPC_sparsemv.hpp"
+#include "mixed_precision.hpp"
+#include "short_indices.hpp"
+#include "value_codes.hpp"
+#include "symmetric_matrix.hpp"
+#include "block_matrix.hpp"
+#include "mytimer.hpp"
+#include "tracked_memory.hpp"
+
+// Calls of each SPARSEMV timing
+const int format_trials = 10;
+
+// Tracked bytes of the matrix on this processor
+static double matrix_memory()
+{
+  return((double) (memory_current(MEM_VALUES) + memory_current(MEM_INDICES)
+		   + memory_current(MEM_ROW_METADATA)));
+}
+
+double time_sparsemv(HPC_Sparse_Matrix * A, int ntrials)
+{
+  double * p = tracked_new_vector(A->local_ncol);
+  double * Ap = tracked_new_vector(A->local_nrow);
+  for (int i=0; i<A->local_ncol; i++) p[i] = 1.0;
+  HPC_sparsemv(A, p, Ap); // Warm up
+  double t0 = mytimer();
+  for (int k=0; k<ntrials; k++) HPC_sparsemv(A, p, Ap);
+  t0 = mytimer() - t0;
+  tracked_delete(p);
+  tracked_delete(Ap);
+  return(t0/((double) ntrials));
+}
+
+static long long local_nnz(HPC_Sparse_Matrix * A)
+{
+  long long nnz = 0;
+  for (int i=0; i<A->local_nrow; i++) nnz += A->nnz_in_row[i];
+  return(nnz);
+}
+
+// Bytes of A's rows that the plain CSR loop reads: the double values,
+// 32-bit indices and row lengths.  Every copy is compared against this.
+static double csr_bytes(HPC_Sparse_Matrix * A)
+{
+  return((sizeof(double)+sizeof(int))*(double) local_nnz(A) + sizeof(int)*(double) A->local_nrow);
+}
+
+// 16-bit indices: rows and nonzeros with them, all nonzeros, all rows
+static void make_short(HPC_Sparse_Matrix * A, double * stats)
+{
+  stats[0] = make_short_indices(A);
+  for (int i=0; i<A->local_nrow; i++)
+    if (A->ptr_to_short_inds_in_row && A->ptr_to_short_inds_in_row[i])
+      stats[1] += A->nnz_in_row[i];
+  stats[2] = local_nnz(A);
+  stats[3] = A->local_nrow;
+}
+
+static void report_short(YAML_Element * section, const double * stats)
+{
+  section->add("Rows with 16-bit indices",(long long) stats[0]);
+  section->add("Rows with 32-bit indices",(long long) (stats[3]-stats[0]));
+  double index_bytes = sizeof(int)*stats[2];
+  double short_index_bytes = index_bytes - (sizeof(int)-sizeof(short))*stats[1];
+  section->add("SPARSEMV index bytes before",index_bytes);
+  section->add("SPARSEMV index bytes after",short_index_bytes);
+  section->add("SPARSEMV index bytes ratio",index_bytes/short_index_bytes);
+}
+
+// Value codes: nonzeros with codes, all nonzeros, bytes of the tables,
+// and SPARSEMV bytes before and after, counting the values or codes and
+// tables, the indices SPARSEMV reads and the row lengths; then the
+// distinct values
+static void make_codes(HPC_Sparse_Matrix * A, double * stats)
+{
+  stats[5] = make_value_codes(A);
+  stats[1] = local_nnz(A);
+  if (A->ptr_to_val_codes_in_row) stats[0] = stats[1];
+  stats[2] = sizeof(double)*(double) A->val_table_size;
+  stats[3] = csr_bytes(A);
+  stats[4] = sizeof(int)*(double) A->local_nrow + stats[2]
+    + (A->ptr_to_val_codes_in_row ? 1.0 : sizeof(double))*stats[1];
+  for (int i=0; i<A->local_nrow; i++)
+    {
+      bool short_row = A->ptr_to_short_inds_in_row && A->ptr_to_short_inds_in_row[i];
+      stats[4] += (short_row ? sizeof(short) : sizeof(int))*(double) A->nnz_in_row[i];
+    }
+}
+
+static void report_codes(YAML_Element * section, const double * stats)
+{
+  section->add("Distinct values per processor",(int) stats[5]);
+  section->add("Nonzeros with value codes",(long long) stats[0]);
+  section->add("Nonzeros with double values",(long long) (stats[1]-stats[0]));
+  double value_bytes = sizeof(double)*stats[1];
+  double code_bytes = value_bytes - (sizeof(double)-1.0)*stats[0] + stats[2];
+  section->add("SPARSEMV value bytes before",value_bytes);
+  section->add("SPARSEMV value bytes after",code_bytes);
+  section->add("SPARSEMV bytes before",stats[3]);
+  section->add("SPARSEMV bytes after",stats[4]);
+  section->add("SPARSEMV bytes ratio",stats[3]/stats[4]);
+}
+
+// Float values: the largest relative rounding error
+static void make_float(HPC_Sparse_Matrix * A, double * stats)
+{
+  stats[0] = make_float_values(A);
+}
+
+// Blocks: processors with blocks, nonzeros, entries stored, and SPARSEMV
+// and index bytes before and after, counting the values, indices and
+// row lengths or block row starts; then the block size
+static void make_blocks(HPC_Sparse_Matrix * A, double * stats)
+{
+  int block_size = make_block_matrix(A);
+  stats[1] = local_nnz(A);
+  stats[2] = stats[1];
+  stats[3] = csr_bytes(A);
+  stats[4] = stats[3];
+  stats[5] = sizeof(int)*stats[1];
+  stats[6] = stats[5];
+  stats[7] = block_size;
+  if (block_size)
+    {
+      long long nblocks;
+      stats[0] = 1.0;
+      stats[4] = block_matrix_bytes(A, block_size, nblocks);
+      stats[2] = ((double) nblocks)*block_size*block_size;
+      stats[6] = sizeof(int)*(double) nblocks;
+    }
+}
+
+static void report_blocks(YAML_Element * section, const double * stats)
+{
+  section->add("Block size",(int) stats[7]);
+  section->add("Processors with blocks",(int) stats[0]);
+  section->add("Nonzeros",stats[1]);
+  section->add("Entries stored",stats[2]);
+  section->add("Fill ratio",stats[2]/stats[1]);
+  section->add("SPARSEMV bytes before",stats[3]);
+  section->add("SPARSEMV bytes after",stats[4]);
+  section->add("SPARSEMV bytes ratio",stats[3]/stats[4]);
+  section->add("SPARSEMV index bytes before",stats[5]);
+  section->add("SPARSEMV index bytes after",stats[6]);
+}
+
+// Upper triangle: processors with it, its off-diagonal entries, its
+// rows and the nonzeros it replaces, all nonzeros, and SPARSEMV bytes
+// before and after.  The triangle's bytes are its values, the indices
+// of all but the diagonal, and the row starts.  A processor that keeps
+// the triangle frees the rest of its matrix, since nothing after the
+// formats reads it.
+static void make_symmetric(HPC_Sparse_Matrix * A, double * stats)
+{
+  stats[4] = local_nnz(A);
+  stats[5] = csr_bytes(A);
+  stats[6] = stats[5];
+  if (make_symmetric_matrix(A))
+    {
+      int nrow = A->local_nrow;
+      stats[0] = 1.0;
+      stats[1] = A->sym_row_start[nrow];
+      stats[2] = nrow;
+      stats[3] = stats[4];
+      stats[6] = (sizeof(double)+sizeof(int))*stats[1] + sizeof(double)*(double) nrow
+	+ sizeof(int)*(double) (nrow+1);
+      destroyFullMatrix(A);
+    }
+  else if (A->local_nrow>0)
+    {
+      int rank = 0;
+#ifdef USING_MPI
+      MPI_Comm_rank(hpccg_comm, &rank);
+#endif
+      cerr << "Processor " << rank << ": the matrix is not symmetric, keeping all of it" << endl;
+    }
+}
+
+static void report_symmetric(YAML_Element * section, const double * stats)
+{
+  section->add("Processors with the upper triangle",(long long) stats[0]);
+  long long stored = (long long) (stats[4] - stats[3] + stats[1] + stats[2]);
+  section->add("Nonzeros",(long long) stats[4]);
+  section->add("Nonzeros stored",stored);
+  section->add("SPARSEMV bytes before",stats[5]);
+  section->add("SPARSEMV bytes after",stats[6]);
+  section->add("SPARSEMV bytes ratio",stats[5]/stats[6]);
+}
+
+struct format_info {
+  const char * section; // Report section, 0 if reported elsewhere
+  int num_sums;         // Statistics summed over processors, then
+  int num_maxes;        // those maxed
+  void (*make)(HPC_Sparse_Matrix * A, double * stats);
+  void (*report)(YAML_Element * section, const double * stats);
+};
+
+static const format_info formats[num_matrix_formats] = {
+  {"Index Compression", 4, 0, make_short, report_short},
+  {"Value Compression", 5, 1, make_codes, report_codes},
+  {0, 0, 1, make_float, 0},
+  {"Block Storage", 7, 1, make_blocks, report_blocks},
+  {"Symmetric Storage", 7, 0, make_symmetric, report_symmetric}
+};
+
+void add_matrix_format(HPC_Sparse_Matrix * A, int format, Format_Result & result)
+{
+  const format_info & info = formats[format];
+  result.format = format;
+  for (int k=0; k<max_format_stats; k++) result.stats[k] = 0.0;
+  result.time_before = time_sparsemv(A, format_trials);
+  result.memory_before = matrix_memory();
+  info.make(A, result.stats);
+  result.memory_after = matrix_memory();
+  result.time_after = time_sparsemv(A, format_trials);
+#ifdef USING_MPI
+  double local[max_format_stats+4];
+  int n = info.num_sums + info.num_maxes;
+  for (int k=0; k<n; k++) local[k] = result.stats[k];
+  local[n] = result.time_before;
+  local[n+1] = result.time_after;
+  local[n+2] = result.memory_before;
+  local[n+3] = result.memory_after;
+  double global[max_format_stats+4];
+  if (info.num_sums>0)
+    MPI_Allreduce(local, global, info.num_sums, MPI_DOUBLE, MPI_SUM, hpccg_comm);
+  MPI_Allreduce(local+info.num_sums, global+info.num_sums, info.num_maxes+4, MPI_DOUBLE,
+		MPI_MAX, hpccg_comm);
+  for (int k=0; k<n; k++) result.stats[k] = global[k];
+  result.time_before = global[n];
+  result.time_after = global[n+1];
+  result.memory_before = global[n+2];
+  result.memory_after = global[n+3];
+#endif
+}
+
+void add_format_report(YAML_Element * doc, const Format_Result & result)
+{
+  const format_info & info = formats[result.format];
+  if (info.section==0) return;
+  YAML_Element * section = doc->add(info.section,"");
+  info.report(section, result.stats);
+  section->add("Matrix memory before",(long long) result.memory_before);
+  section->add("Matrix memory after",(long long) result.memory_after);
+  section->add("SPARSEMV time before",result.time_before);
+  section->add("SPARSEMV time after",result.time_after);
+  section->add("SPARSEMV speedup",result.time_before/result.time_after);
+}
@@ -0,0 +1,77 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+#ifndef MATRIX_FORMATS_H
+#define MATRIX_FORMATS_H
+#include "HPC_Sparse_Matrix.hpp"
+#include "YAML_Element.hpp"
+
+// Copies of the matrix that the run-time options can add for
+// HPC_sparsemv, in the order they are made
+enum { FORMAT_SHORT_INDICES, FORMAT_VALUE_CODES, FORMAT_FLOAT_VALUES, FORMAT_BLOCKS,
+       FORMAT_SYMMETRIC, num_matrix_formats };
+
+const int max_format_stats = 8;
+
+struct Format_Result_STRUCT {
+  int format;
+  double stats[max_format_stats]; // Counts summed and sizes maxed over processors
+  double time_before;             // SPARSEMV time without and with the copy,
+  double time_after;              // max over processors
+  double memory_before;           // Tracked matrix bytes without and with the
+  double memory_after;            // copy, max over processors
+};
+typedef struct Format_Result_STRUCT Format_Result;
+
+// Average time of one HPC_sparsemv call over ntrials calls on this
+// processor
+double time_sparsemv(HPC_Sparse_Matrix * A, int ntrials);
+
+// Makes A's copy in format, timing SPARSEMV before and after.  Must be
+// called by all processors.
+void add_matrix_format(HPC_Sparse_Matrix * A, int format, Format_Result & result);
+
+// Adds the format's report section to doc, if it has one.  The float
+// values are reported with the solve, under "Mixed Precision": stats[0]
+// is the largest relative rounding error.
+void add_format_report(YAML_Element * doc, const Format_Result & result);
+#endif
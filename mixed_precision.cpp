@@ -0,0 +1,128 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Routines to keep the matrix values in single precision for
+// HPC_sparsemv.  The values are most of the bytes it reads, so halving
+// them speeds it up when it is memory bound; x, y and the sums stay
+// double.  HPCCG_refine recovers double-precision residuals.
+
+// make_float_values - Copies the values of A to float, row by row in the
+//                     order of A's rows, in parallel (see first touch in
+//                     tracked_memory.hpp).  The double values are kept
+//                     for residual_norm.
+
+// residual_norm - ||b - Ax|| with the double values, as for the
+//                 initial residual in HPCCG.
+
+/////////////////////////////////////////////////////////////////////////
+
+#include <cmath>
+#include "mixed_precision.hpp"
+#include "HPC_sparsemv.hpp"
+#include "waxpby.hpp"
+#include "ddot.hpp"
+#ifdef USING_MPI
+#include "exchange_externals.hpp"
+#endif
+#include "tracked_memory.hpp"
+
+double make_float_values(HPC_Sparse_Matrix * A)
+{
+  const int nrow = A->local_nrow;
+  if (A->list_of_float_vals) tracked_delete(A->list_of_float_vals);
+  if (A->ptr_to_float_vals_in_row) tracked_delete(A->ptr_to_float_vals_in_row);
+
+  long long nnz = 0;
+  for (int i=0; i<nrow; i++) nnz += A->nnz_in_row[i];
+  float * list_of_float_vals = tracked_new<float>(nnz, MEM_VALUES);
+  float ** ptr_to_float_vals_in_row = tracked_new<float*>(nrow, MEM_ROW_METADATA);
+  long long offset = 0;
+  for (int i=0; i<nrow; i++)
+    {
+      ptr_to_float_vals_in_row[i] = list_of_float_vals+offset;
+      offset += A->nnz_in_row[i];
+    }
+
+  double max_error = 0.0;
+#ifdef USING_OMP
+#pragma omp parallel for schedule(static) reduction(max:max_error)
+#endif
+  for (int i=0; i<nrow; i++)
+    {
+      const double * const cur_vals = A->ptr_to_vals_in_row[i];
+      float * const cur_float_vals = ptr_to_float_vals_in_row[i];
+      for (int j=0; j<A->nnz_in_row[i]; j++)
+	{
+	  cur_float_vals[j] = (float) cur_vals[j];
+	  if (cur_vals[j]==0.0) continue;
+	  double error = fabs((cur_float_vals[j]-cur_vals[j])/cur_vals[j]);
+	  if (error>max_error) max_error = error;
+	}
+    }
+
+  A->list_of_float_vals = list_of_float_vals;
+  A->ptr_to_float_vals_in_row = ptr_to_float_vals_in_row;
+  return(max_error);
+}
+
+double residual_norm(HPC_Sparse_Matrix * A, const double * const b, const double * const x,
+		     double * const r)
+{
+  const int nrow = A->local_nrow;
+  double * p = tracked_new_vector(A->local_ncol); // x with the external entries
+  double * Ap = tracked_new_vector(nrow);
+  waxpby(nrow, 1.0, x, 0.0, x, p);
+#ifdef USING_MPI
+  double t_wait = 0.0;
+  exchange_externals(A, p, t_wait);
+#endif
+  HPC_sparsemv(A, p, Ap, true);
+  double * res = r ? r : Ap;
+  waxpby(nrow, 1.0, b, -1.0, Ap, res);
+  double rtrans = 0.0, t_allreduce = 0.0;
+  ddot(nrow, res, res, &rtrans, t_allreduce);
+  tracked_delete(p);
+  tracked_delete(Ap);
+  return(sqrt(rtrans));
+}
@@ -42,8 +42,17 @@
 /////////////////////////////////////////////////////////////////////////
 
 // Function to return time in seconds.
-// If compiled with no flags, return CPU time (user and system).
-// If compiled with -DWALL, returns elapsed time.
+// If compiled with -DUSING_MPI, returns MPI_Wtime().
+// If compiled with no flags, returns elapsed time from the monotonic
+// clock (clock_gettime with CLOCK_MONOTONIC), which has nanosecond
+// resolution and is not affected by the number of OpenMP threads.
+// If compiled with -DWALL, returns elapsed time from gettimeofday.
+// If compiled with -DUseRusage, returns user CPU time of the process
+// (summed over all threads).
+// -DUseClock and -DUseTimes select clock() and times() respectively.
+
+// mytimer_resolution returns the resolution of the timer in seconds and
+// mytimer_name a short description, for reporting.
 
 /////////////////////////////////////////////////////////////////////////
 #ifdef USING_MPI
@@ -54,10 +63,19 @@ double mytimer(void)
    return(MPI_Wtime());
 }
 
+double mytimer_resolution(void)
+{
+   return(MPI_Wtick());
+}
+
+const char * mytimer_name(void)
+{
+   return("MPI_Wtime");
+}
 
 #elif defined(UseClock)
 
-#include <time.hpp>
+#include <ctime>
 double mytimer(void)
 {
    clock_t t1;
@@ -71,6 +89,16 @@ double mytimer(void)
    return(d);
 }
 
+double mytimer_resolution(void)
+{
+   return(1.0/CLOCKS_PER_SEC);
+}
+
+const char * mytimer_name(void)
+{
+   return("clock (CPU time)");
+}
+
 #elif defined(WALL)
 
 #include <cstdlib>
@@ -91,6 +119,16 @@ double mytimer(void)
    return( ((double) (tp.tv_sec - start)) + (tp.tv_usec-startu)/1000000.0 );
 }
 
+double mytimer_resolution(void)
+{
+   return(1.0e-6);
+}
+
+const char * mytimer_name(void)
+{
+   return("gettimeofday");
+}
+
 #elif defined(UseTimes)
 
 #include <cstdlib>
@@ -106,7 +144,17 @@ double mytimer(void)
    return( (double) ts.tms_utime / ClockTick );
 }
 
-#else
+double mytimer_resolution(void)
+{
+   return(1.0/((double) sysconf(_SC_CLK_TCK)));
+}
+
+const char * mytimer_name(void)
+{
+   return("times (CPU time)");
+}
+
+#elif defined(UseRusage)
 
 #include <cstdlib>
 #include <sys/time.h>
@@ -118,4 +166,39 @@ double mytimer(void)
    return( (double)(ruse.ru_utime.tv_sec+ruse.ru_utime.tv_usec / 1000000.0) );
 }
 
+double mytimer_resolution(void)
+{
+   return(1.0e-6);
+}
+
+const char * mytimer_name(void)
+{
+   return("getrusage (CPU time)");
+}
+
+#else
+
+#include <ctime>
+double mytimer(void)
+{
+   // The monotonic clock counts from boot, so even after a year of uptime
+   // a double holds it to within 10 ns.  Keeping no starting point means
+   // there is no state to set up when called from several threads.
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return( ((double) ts.tv_sec) + ts.tv_nsec/1.0e9 );
+}
+
+double mytimer_resolution(void)
+{
+   struct timespec ts;
+   clock_getres(CLOCK_MONOTONIC, &ts);
+   return( ((double) ts.tv_sec) + ts.tv_nsec/1.0e9 );
+}
+
+const char * mytimer_name(void)
+{
+   return("clock_gettime(CLOCK_MONOTONIC)");
+}
+
 #endif
@@ -42,4 +42,6 @@
 #ifndef MYTIMER_H
 #define MYTIMER_H
 double mytimer(void);
+double mytimer_resolution(void);
+const char * mytimer_name(void);
 #endif // MYTIMER_H
@@ -0,0 +1,299 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Routine to parse the name=value options that may follow the
+// positional arguments of test_HPCCG.
+
+// argc, argv - as passed to main
+
+// options - On exit contains defaults overridden by command line values.
+
+/////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+using std::cerr;
+using std::endl;
+#include <cstdlib>
+#include <cstring>
+#include "parse_options.hpp"
+#include "sparsemv_simd.hpp"
+
+const char * option_value(const char * arg, const char * name)
+{
+  size_t len = strlen(name);
+  if (strncmp(arg, name, len)==0 && arg[len]=='=') return(arg+len+1);
+  return(0);
+}
+
+// Parses a byte count with an optional K, M or G (binary) suffix.
+// Returns -1 if value is not of that form.
+static long long byte_count(const char * value)
+{
+  char * end;
+  double count = strtod(value, &end);
+  if (end==value) return(-1);
+  if (*end=='K' || *end=='k') { count *= 1024.0; end++; }
+  else if (*end=='M' || *end=='m') { count *= 1024.0*1024.0; end++; }
+  else if (*end=='G' || *end=='g') { count *= 1024.0*1024.0*1024.0; end++; }
+  if (*end!='\0') return(-1);
+  return((long long) count);
+}
+
+int count_positional(int argc, char *argv[])
+{
+  // Positional arguments come first, options are everything after
+  int num_positional = 0;
+  while (num_positional+1<argc && strchr(argv[num_positional+1],'=')==0) num_positional++;
+  return(num_positional);
+}
+
+int parse_options(int argc, char *argv[], HPCCG_Options & options)
+{
+  options.partition_graph = 1;
+  options.reorder_rows = 0;
+  options.dump_file = 0;
+  options.checkpoint_interval = 0;
+  options.checkpoint_prefix = "hpccg_checkpoint";
+  options.restart = 0;
+  options.trace = 0;
+  options.trace_file = 0;
+  options.counters = 0;
+  options.peak_bandwidth = 0.0;
+  options.roofline = 0;
+  options.stream_size = 4000000;
+  options.scaling = 0;
+  options.scaling_ranks = 0;
+  options.dry_run = 0;
+  options.memory_fraction = 0.0;
+  options.memory_per_rank = 0;
+  options.simd_isa = SIMD_AVX512;
+  options.fixed_width = 1;
+  options.float_values = 0;
+  options.short_indices = 0;
+  options.value_codes = 0;
+  options.symmetric = 0;
+  options.bcsr = 0;
+  options.tune = 0;
+  options.tune_file = "hpccg_tune.txt";
+  options.refine = 0;
+  options.tolerance = 0.0;
+  options.huge_pages = 1;
+  options.json = 0;
+  options.results_dir = 0;
+  options.results_file = 0;
+
+  int num_positional = count_positional(argc, argv);
+
+  for (int i=num_positional+1; i<argc; i++)
+    {
+      const char * value;
+      if ((value = option_value(argv[i], "partition")))
+	options.partition_graph = atoi(value);
+      else if ((value = option_value(argv[i], "reorder")))
+	{
+	  if (strcmp(value,"none")==0) options.reorder_rows = 0;
+	  else if (strcmp(value,"rcm")==0) options.reorder_rows = 1;
+	  else if (strcmp(value,"morton")==0) options.reorder_rows = 2;
+	  else
+	    {
+	      cerr << "Unknown reordering: " << value << endl;
+	      return(-1);
+	    }
+	}
+      else if ((value = option_value(argv[i], "dump")))
+	options.dump_file = value;
+      else if ((value = option_value(argv[i], "checkpoint")))
+	options.checkpoint_interval = atoi(value);
+      else if ((value = option_value(argv[i], "checkpoint_prefix")))
+	options.checkpoint_prefix = value;
+      else if ((value = option_value(argv[i], "restart")))
+	options.restart = atoi(value);
+      else if ((value = option_value(argv[i], "trace")))
+	options.trace = atoi(value);
+      else if ((value = option_value(argv[i], "trace_file")))
+	{
+	  options.trace_file = value;
+	  options.trace = 1;
+	}
+      else if ((value = option_value(argv[i], "counters")))
+	options.counters = atoi(value);
+      else if ((value = option_value(argv[i], "peak_bandwidth")))
+	options.peak_bandwidth = atof(value);
+      else if ((value = option_value(argv[i], "roofline")))
+	options.roofline = atoi(value);
+      else if ((value = option_value(argv[i], "stream_size")))
+	options.stream_size = atoi(value);
+      else if ((value = option_value(argv[i], "scaling")))
+	{
+	  if (strcmp(value,"none")==0) options.scaling = 0;
+	  else if (strcmp(value,"strong")==0) options.scaling = 1;
+	  else if (strcmp(value,"weak")==0) options.scaling = 2;
+	  else
+	    {
+	      cerr << "Unknown scaling study: " << value << endl;
+	      return(-1);
+	    }
+	}
+      else if ((value = option_value(argv[i], "scaling_ranks")))
+	options.scaling_ranks = value;
+      else if ((value = option_value(argv[i], "dry_run")))
+	options.dry_run = atoi(value);
+      else if ((value = option_value(argv[i], "memory_fraction")))
+	{
+	  options.memory_fraction = atof(value);
+	  if (options.memory_fraction<=0.0 || options.memory_fraction>1.0)
+	    {
+	      cerr << "memory_fraction must be in (0,1]: " << value << endl;
+	      return(-1);
+	    }
+	}
+      else if ((value = option_value(argv[i], "memory_per_rank")))
+	{
+	  if ((options.memory_per_rank = byte_count(value))<=0)
+	    {
+	      cerr << "Invalid memory_per_rank: " << value << endl;
+	      return(-1);
+	    }
+	}
+      else if ((value = option_value(argv[i], "simd")))
+	{
+	  if (strcmp(value,"auto")==0) options.simd_isa = SIMD_AVX512;
+	  else if (strcmp(value,"scalar")==0) options.simd_isa = SIMD_SCALAR;
+	  else if (strcmp(value,"sse2")==0) options.simd_isa = SIMD_SSE2;
+	  else if (strcmp(value,"avx2")==0) options.simd_isa = SIMD_AVX2;
+	  else if (strcmp(value,"avx512")==0) options.simd_isa = SIMD_AVX512;
+	  else
+	    {
+	      cerr << "Unknown instruction set: " << value << endl;
+	      return(-1);
+	    }
+	}
+      else if ((value = option_value(argv[i], "fixed_width")))
+	options.fixed_width = atoi(value);
+      else if ((value = option_value(argv[i], "float_values")))
+	options.float_values = atoi(value);
+      else if ((value = option_value(argv[i], "short_indices")))
+	options.short_indices = atoi(value);
+      else if ((value = option_value(argv[i], "value_codes")))
+	options.value_codes = atoi(value);
+      else if ((value = option_value(argv[i], "symmetric")))
+	options.symmetric = atoi(value);
+      else if ((value = option_value(argv[i], "bcsr")))
+	options.bcsr = atoi(value);
+      else if ((value = option_value(argv[i], "tune")))
+	options.tune = atoi(value);
+      else if ((value = option_value(argv[i], "tune_file")))
+	options.tune_file = *value ? value : 0;
+      else if ((value = option_value(argv[i], "refine")))
+	options.refine = atoi(value);
+      else if ((value = option_value(argv[i], "tolerance")))
+	{
+	  options.tolerance = atof(value);
+	  if (options.tolerance<0.0)
+	    {
+	      cerr << "tolerance must not be negative: " << value << endl;
+	      return(-1);
+	    }
+	}
+      else if ((value = option_value(argv[i], "huge_pages")))
+	options.huge_pages = atoi(value);
+      else if ((value = option_value(argv[i], "output_format")))
+	{
+	  if (strcmp(value,"yaml")==0) options.json = 0;
+	  else if (strcmp(value,"json")==0) options.json = 1;
+	  else
+	    {
+	      cerr << "Unknown output format: " << value << endl;
+	      return(-1);
+	    }
+	}
+      else if ((value = option_value(argv[i], "results_dir")))
+	options.results_dir = value;
+      else if ((value = option_value(argv[i], "results_file")))
+	options.results_file = value;
+      else
+	{
+	  cerr << "Unknown option: " << argv[i] << endl;
+	  return(-1);
+	}
+    }
+  return(num_positional);
+}
+
+void print_options_usage()
+{
+  cerr << "Options (name=value):" << endl
+       << "     partition=0|1  Repartition file-read matrices to reduce edge cut (default 1)" << endl
+       << "     reorder=none|rcm|morton  Renumber local rows for SpMV locality (default none)" << endl
+       << "     dump=file  Write the matrix to file (Matrix Market if file ends in .mtx)" << endl
+       << "     checkpoint=N  Save the solver state every N iterations (default 0, off)" << endl
+       << "     checkpoint_prefix=path  Checkpoint file prefix (default hpccg_checkpoint)" << endl
+       << "     restart=0|1  Resume from the latest complete checkpoint (default 0)" << endl
+       << "     trace=0|1  Report the distribution of per-iteration kernel times (default 0)" << endl
+       << "     trace_file=file.json  Also write the trace in Chrome trace-event format" << endl
+       << "     counters=0|1  Count hardware events in each kernel (default 0)" << endl
+       << "     peak_bandwidth=GB/s  Peak memory bandwidth used to rate the counters" << endl
+       << "     roofline=0|1  Measure memory bandwidth and report kernels against it (default 0)" << endl
+       << "     stream_size=N  Length of the bandwidth probe vectors (default 4000000)" << endl
+       << "     scaling=none|strong|weak  Run a scaling study instead (generated matrices only)" << endl
+       << "     scaling_ranks=p1,p2,...  Processor counts of the study (default 1,2,4,...)" << endl
+       << "     dry_run=0|1  Only estimate the memory of a generated matrix (default 0)" << endl
+       << "     memory_fraction=F  Size nx ny nz to fill fraction F of available node memory" << endl
+       << "     memory_per_rank=bytes  Size nx ny nz to fill bytes (K, M, G suffix) per processor" << endl
+       << "     simd=auto|scalar|sse2|avx2|avx512  SPARSEMV instruction set (default auto, the best supported)" << endl
+       << "     fixed_width=0|1  Unroll SPARSEMV for the stencil's row width (default 1)" << endl
+       << "     short_indices=0|1  Store the column indices for SPARSEMV in 16 bits (default 0)" << endl
+       << "     bcsr=0|1  Store the matrix for SPARSEMV in 2x2, 3x3 or 4x4 blocks if it has them (default 0)" << endl
+       << "     symmetric=0|1  Store only the upper triangle of the matrix for SPARSEMV (default 0)" << endl
+       << "     value_codes=0|1  Store the matrix values for SPARSEMV as 1-byte codes (default 0)" << endl
+       << "     float_values=0|1  Store the matrix values for SPARSEMV as float (default 0)" << endl
+       << "     tune=0|1|2  Time the SPARSEMV formats and keep the fastest, 2 ignoring the cache (default 0)" << endl
+       << "     tune_file=path  Cache of tuned SPARSEMV choices, empty for none (default hpccg_tune.txt)" << endl
+       << "     refine=0|1  Solve by iterative refinement in double precision (default 0)" << endl
+       << "     tolerance=T  Stop at residual norm T (default 0, run all iterations)" << endl
+       << "     huge_pages=0|1  Back large arrays with 2 MB pages where available (default 1)" << endl
+       << "     output_format=yaml|json  Format of the report and results file (default yaml)" << endl
+       << "     results_dir=path  Directory of the results file (default .)" << endl
+       << "     results_file=stem  Results file name before the timestamp (default hpccg-1.0_)" << endl;
+}
@@ -0,0 +1,102 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+#ifndef PARSE_OPTIONS_H
+#define PARSE_OPTIONS_H
+
+// Run-time options.  These follow the positional arguments on the
+// command line and are each given as name=value, e.g.
+//
+//   test_HPCCG 50 50 50 partition=0
+
+struct HPCCG_Options_STRUCT {
+  int partition_graph; // Repartition file-read matrices to reduce edge cut (MPI only)
+  int reorder_rows;    // 0 = none, 1 = reverse Cuthill-McKee, 2 = Morton curve (generated matrices only)
+  const char * dump_file; // If set, write the matrix to this file before the solve
+  int checkpoint_interval;   // Iterations between checkpoints, 0 to disable
+  const char * checkpoint_prefix; // Checkpoint files are prefix.rank.slot
+  int restart;         // Resume from the latest complete checkpoint
+  int trace;           // Record per-iteration kernel times and report their distribution
+  const char * trace_file; // If set, also write the trace here in Chrome trace-event JSON
+  int counters;        // Count hardware events in each kernel with perf_event_open
+  double peak_bandwidth; // Peak memory bandwidth of all processors in GB/s, 0 if unknown
+  int roofline;        // Measure memory bandwidth and report kernels against it
+  int stream_size;     // Length of each STREAM vector, per processor
+  int scaling;         // 0 = single run, 1 = strong scaling study, 2 = weak scaling study
+  const char * scaling_ranks; // Comma-separated processor counts of the study, 0 for powers of 2
+  int dry_run;         // Only estimate the memory a generated problem needs, then exit
+  double memory_fraction; // If nx ny nz are not given, fill this fraction of node memory
+  long long memory_per_rank; // If nx ny nz are not given, fill this many bytes per processor
+  int simd_isa;        // SPARSEMV instruction set (SIMD_* in sparsemv_simd.hpp), lowered to the best supported
+  int fixed_width;     // Let SPARSEMV use kernels unrolled for the most common row width
+  int float_values;    // Store the matrix values for SPARSEMV in single precision
+  int short_indices;   // Store the column indices for SPARSEMV as 16-bit offsets from the row
+  int value_codes;     // Store the matrix values for SPARSEMV as 1-byte codes into a table
+  int symmetric;       // Store only the upper triangle of the matrix for SPARSEMV
+  int bcsr;            // Store the matrix for SPARSEMV in dense blocks if it has them
+  int tune;            // 0 = no tuning, 1 = time the SPARSEMV formats or use the cached choice, 2 = always time them
+  const char * tune_file; // Cache of tuned choices, 0 for none
+  int refine;          // Solve by iterative refinement, with residuals from the double values
+  double tolerance;    // Stop when the residual norm is at most this, 0 to do max_iter iterations
+  int huge_pages;      // Back large arrays with 2 MB pages where the system allows
+  int json;            // Print the report, and write the results file, as JSON instead of YAML
+  const char * results_dir;  // Directory of the results file, 0 for the current directory
+  const char * results_file; // Stem of the results file name, 0 for hpccg-1.0_
+};
+typedef struct HPCCG_Options_STRUCT HPCCG_Options;
+
+// Fills options with defaults, then overrides them with any name=value
+// arguments.  Returns the number of positional arguments (not counting
+// argv[0]), or -1 if an option is not recognized.
+
+int parse_options(int argc, char *argv[], HPCCG_Options & options);
+
+// Prints the options parse_options takes, with their defaults, to cerr
+void print_options_usage();
+
+// Helpers for other drivers' options: the number of arguments before
+// the first name=value one (not counting argv[0]), and the text after
+// "name=" if arg is of that form, otherwise 0.
+
+int count_positional(int argc, char *argv[]);
+const char * option_value(const char * arg, const char * name);
+#endif
@@ -0,0 +1,769 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Routine to redistribute the rows of a matrix that still uses global
+// indices (i.e., before make_local_matrix) so that rows strongly
+// coupled in the sparsity graph land on the same processor.
+
+// A - On entry, matrix with contiguous block rows as produced by
+//     read_HPC_row.  On exit, same operator with rows renumbered so each
+//     processor again owns a contiguous block, chosen to reduce the
+//     number of cut edges.
+
+// x, b, xexact - Vectors redistributed and renumbered along with A.
+
+// edge_cut_before/after - Number of graph edges joining rows owned by
+//                         different processors.
+
+// halo_volume_before/after - Sum over processors of the number of
+//                            distinct external columns (num_external).
+
+// The partition is multilevel.  Each processor coarsens the graph of its
+// own rows by repeated heavy-edge matching until about
+// coarse_rows_per_proc vertices are left, so no processor holds more
+// than its rows, their external columns and a few size-long arrays.
+// The coarse graph is gathered on processor 0 and split by recursive
+// bisection: each bisection grows a breadth-first region from a
+// pseudo-peripheral vertex and is then refined by greedily moving
+// boundary vertices that reduce the cut.  Each processor is sent the
+// parts of its own coarse vertices only, and projects them onto its rows.
+// If the result does not reduce the halo volume of the original block
+// partition, the original is kept.
+
+// Limits: matching only joins rows on the same processor, so the coarse
+// graph is only as small as each processor's rows are coupled among
+// themselves.  If the file ordering has no locality at all, coarsening
+// stalls and processor 0 receives nearly the whole graph, as a serial
+// partitioner would.  There is no refinement after projection, so the
+// cut is larger than that of a full parallel partitioner such as
+// ParMETIS; the serial bisection of the coarse graph keeps the code free
+// of external dependencies.
+
+/////////////////////////////////////////////////////////////////////////
+
+#ifdef USING_MPI  // Compile this routine only if running in parallel
+#include <iostream>
+using std::cout;
+using std::cerr;
+using std::endl;
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cassert>
+#include "partition_matrix.hpp"
+#include "tracked_memory.hpp"
+#include "hpccg_comm.hpp"
+
+// Each processor coarsens its rows until about this many vertices are
+// left, or until matching stops shrinking the graph.
+const int coarse_rows_per_proc = 512;
+
+// Graph of some of a processor's rows: vertex i has weight vwgt[i] and
+// neighbors adj[k], joined by edges of weight adjwgt[k], for k from
+// xadj[i] to xadj[i+1]-1.
+struct Local_Graph
+{
+  std::vector<int> vwgt;
+  std::vector<int> xadj;
+  std::vector<int> adj;
+  std::vector<int> adjwgt;
+};
+
+// Sends ghost_ids (sorted, and owned by other processors) to their
+// owners, which reply with values[] of those rows.  Processor p owns
+// rows row_offsets[p] to row_offsets[p+1]-1.
+static void fetch_ghost_values(const std::vector<int> & ghost_ids, const int * row_offsets,
+			       int start_row, const std::vector<int> & values,
+			       std::vector<int> & ghost_values)
+{
+  int size, p;
+  MPI_Comm_size(hpccg_comm, &size);
+  std::vector<int> send_counts(size, 0), recv_counts(size);
+  std::vector<int> send_displs(size+1), recv_displs(size+1);
+  p = 0;
+  for (size_t i=0; i<ghost_ids.size(); i++)
+    {
+      while (ghost_ids[i]>=row_offsets[p+1]) p++;
+      send_counts[p]++;
+    }
+  MPI_Alltoall(send_counts.data(), 1, MPI_INT, recv_counts.data(), 1, MPI_INT, hpccg_comm);
+  send_displs[0] = recv_displs[0] = 0;
+  for (p=0; p<size; p++)
+    {
+      send_displs[p+1] = send_displs[p] + send_counts[p];
+      recv_displs[p+1] = recv_displs[p] + recv_counts[p];
+    }
+
+  std::vector<int> requests(recv_displs[size]);
+  MPI_Alltoallv((void *) ghost_ids.data(), send_counts.data(), send_displs.data(), MPI_INT,
+		requests.data(), recv_counts.data(), recv_displs.data(), MPI_INT, hpccg_comm);
+  for (size_t i=0; i<requests.size(); i++) requests[i] = values[requests[i]-start_row];
+  ghost_values.resize(ghost_ids.size());
+  MPI_Alltoallv(requests.data(), recv_counts.data(), recv_displs.data(), MPI_INT,
+		ghost_values.data(), send_counts.data(), send_displs.data(), MPI_INT, hpccg_comm);
+}
+
+// Edge cut and halo volume, summed over all processors, of the partition
+// that puts local row i in part[i] and external column ghost_ids[g] in
+// ghost_part[g].  slot[] numbers the nonzeros as in partition_matrix.
+static void partition_quality(int local_nrow, int start_row, const int * nnz_in_row,
+			      const std::vector<int> & slot, const std::vector<int> & ghost_ids,
+			      const std::vector<int> & part, const std::vector<int> & ghost_part,
+			      long long & edge_cut, long long & halo_volume)
+{
+  int size, p;
+  MPI_Comm_size(hpccg_comm, &size);
+
+  // Each cut edge adds its column to the halo of the row's part.  The
+  // rows of a part may be spread over processors, so the owner of each
+  // part counts the distinct columns sent to it.
+  std::vector<long long> halo; // Part in the high word, column in the low
+  long long cut = 0;
+  for (int i=0, k=0; i<local_nrow; i++)
+    for (int j=0; j<nnz_in_row[i]; j++, k++)
+      {
+	int s = slot[k];
+	if (s==i) continue;
+	int other = (s<local_nrow) ? part[s] : ghost_part[s-local_nrow];
+	if (other==part[i]) continue;
+	int col = (s<local_nrow) ? start_row+s : ghost_ids[s-local_nrow];
+	cut++;
+	halo.push_back((((long long) part[i])<<32) + col);
+      }
+  std::sort(halo.begin(), halo.end());
+  halo.erase(std::unique(halo.begin(), halo.end()), halo.end());
+
+  std::vector<int> send_counts(size, 0), recv_counts(size);
+  std::vector<int> send_displs(size+1), recv_displs(size+1);
+  std::vector<int> cols(halo.size());
+  for (size_t h=0; h<halo.size(); h++)
+    {
+      send_counts[halo[h]>>32]++;
+      cols[h] = (int) (halo[h] & 0xffffffffLL);
+    }
+  MPI_Alltoall(send_counts.data(), 1, MPI_INT, recv_counts.data(), 1, MPI_INT, hpccg_comm);
+  send_displs[0] = recv_displs[0] = 0;
+  for (p=0; p<size; p++)
+    {
+      send_displs[p+1] = send_displs[p] + send_counts[p];
+      recv_displs[p+1] = recv_displs[p] + recv_counts[p];
+    }
+  std::vector<int> my_halo(recv_displs[size]);
+  MPI_Alltoallv(cols.data(), send_counts.data(), send_displs.data(), MPI_INT,
+		my_halo.data(), recv_counts.data(), recv_displs.data(), MPI_INT, hpccg_comm);
+  std::sort(my_halo.begin(), my_halo.end());
+
+  long long local_stats[2], stats[2];
+  local_stats[0] = cut;
+  local_stats[1] = std::unique(my_halo.begin(), my_halo.end()) - my_halo.begin();
+  MPI_Allreduce(local_stats, stats, 2, MPI_LONG_LONG, MPI_SUM, hpccg_comm);
+  edge_cut = stats[0]/2; // Structurally symmetric, so each edge is seen from both ends
+  halo_volume = stats[1];
+}
+
+// Matches each vertex of g with its unmatched neighbor across the
+// heaviest edge, as long as the pair weighs at most max_vwgt, and
+// contracts each pair into one vertex of cg.  cmap[v] is the vertex of
+// cg containing v.
+static void coarsen(const Local_Graph & g, int max_vwgt, Local_Graph & cg, std::vector<int> & cmap)
+{
+  int n = g.vwgt.size();
+  std::vector<int> match(n, -1);
+  cmap.assign(n, -1);
+  int cn = 0;
+  for (int v=0; v<n; v++)
+    {
+      if (match[v]>=0) continue;
+      int best = v, best_wgt = 0;
+      for (int k=g.xadj[v]; k<g.xadj[v+1]; k++)
+	{
+	  int u = g.adj[k];
+	  if (match[u]<0 && u!=v && g.adjwgt[k]>best_wgt && g.vwgt[v]+g.vwgt[u]<=max_vwgt)
+	    {
+	      best = u;
+	      best_wgt = g.adjwgt[k];
+	    }
+	}
+      match[v] = best;
+      match[best] = v;
+      cmap[v] = cmap[best] = cn++;
+    }
+
+  // Vertices before v are all matched when v is visited, so each pair is
+  // led by its lower vertex and coarse vertices follow their leaders.
+  cg.vwgt.assign(cn, 0);
+  cg.xadj.assign(1, 0);
+  cg.adj.clear();
+  cg.adjwgt.clear();
+  std::vector<int> pos(cn, -1); // Where each neighbor was put in cg.adj
+  for (int v=0, c=0; v<n; v++)
+    {
+      if (match[v]<v) continue;
+      int row_begin = cg.adj.size();
+      int members[2] = {v, match[v]};
+      int num_members = (match[v]==v) ? 1 : 2;
+      for (int m=0; m<num_members; m++)
+	{
+	  int w = members[m];
+	  cg.vwgt[c] += g.vwgt[w];
+	  for (int k=g.xadj[w]; k<g.xadj[w+1]; k++)
+	    {
+	      int cu = cmap[g.adj[k]];
+	      if (cu==c) continue;
+	      if (pos[cu]>=row_begin)
+		cg.adjwgt[pos[cu]] += g.adjwgt[k];
+	      else
+		{
+		  pos[cu] = cg.adj.size();
+		  cg.adj.push_back(cu);
+		  cg.adjwgt.push_back(g.adjwgt[k]);
+		}
+	    }
+	}
+      cg.xadj.push_back(cg.adj.size());
+      c++;
+    }
+}
+
+// Breadth-first search over the vertices labeled "stamp", starting at
+// start.  Returns the last vertex reached.  Leaves the visit order in queue.
+static int bfs(const int * row_ptr, const int * cols, const int * label, int stamp,
+	       int start, int * visited, int visit_stamp, std::vector<int> & queue)
+{
+  queue.clear();
+  queue.push_back(start);
+  visited[start] = visit_stamp;
+  for (size_t head=0; head<queue.size(); head++)
+    {
+      int v = queue[head];
+      for (int k=row_ptr[v]; k<row_ptr[v+1]; k++)
+	{
+	  int u = cols[k];
+	  if (label[u]==stamp && visited[u]!=visit_stamp)
+	    {
+	      visited[u] = visit_stamp;
+	      queue.push_back(u);
+	    }
+	}
+    }
+  return(queue.back());
+}
+
+// Splits verts into nparts parts numbered first_part, first_part+1, ...
+// of about equal vertex weight vwgt, reducing the weight adjwgt of the
+// cut edges.
+static void recursive_bisection(const int * row_ptr, const int * cols, const int * adjwgt,
+				const int * vwgt, std::vector<int> & verts, int first_part,
+				int nparts, int * part, int * label, int * side, int * visited,
+				int & stamp)
+{
+  int nv = verts.size();
+  if (nparts==1 || nv==0)
+    {
+      for (int i=0; i<nv; i++) part[verts[i]] = first_part;
+      return;
+    }
+
+  long long total_wgt = 0;
+  int max_wgt = 0;
+  for (int i=0; i<nv; i++)
+    {
+      total_wgt += vwgt[verts[i]];
+      if (vwgt[verts[i]]>max_wgt) max_wgt = vwgt[verts[i]];
+    }
+  int nparts0 = nparts/2;
+  long long target0 = (total_wgt * nparts0)/nparts;
+  long long tol = total_wgt/50; if (tol<max_wgt) tol = max_wgt;
+
+  int my_stamp = ++stamp;
+  for (int i=0; i<nv; i++) { label[verts[i]] = my_stamp; side[verts[i]] = 1; }
+
+  // Grow side 0 from a pseudo-peripheral vertex.  Two sweeps are usually
+  // enough to find a vertex near the end of a long path through the graph.
+  std::vector<int> queue;
+  int start = bfs(row_ptr, cols, label, my_stamp, verts[0], visited, ++stamp, queue);
+  start = bfs(row_ptr, cols, label, my_stamp, start, visited, ++stamp, queue);
+
+  long long wgt0 = 0;
+  int visit_stamp = ++stamp;
+  int next_unvisited = 0;
+  std::vector<int> region;
+  region.push_back(start);
+  visited[start] = visit_stamp;
+  size_t head = 0;
+  while (wgt0<target0)
+    {
+      if (head==region.size()) // Region exhausted a connected component
+	{
+	  while (visited[verts[next_unvisited]]==visit_stamp) next_unvisited++;
+	  region.push_back(verts[next_unvisited]);
+	  visited[verts[next_unvisited]] = visit_stamp;
+	}
+      int v = region[head++];
+      side[v] = 0;
+      wgt0 += vwgt[v];
+      for (int k=row_ptr[v]; k<row_ptr[v+1]; k++)
+	{
+	  int u = cols[k];
+	  if (label[u]==my_stamp && visited[u]!=visit_stamp)
+	    {
+	      visited[u] = visit_stamp;
+	      region.push_back(u);
+	    }
+	}
+    }
+
+  // Greedy boundary refinement: move any vertex more strongly connected
+  // to the other side than to its own, as long as balance stays within tol.
+  for (int pass=0; pass<8; pass++)
+    {
+      int moves = 0;
+      for (int i=0; i<nv; i++)
+	{
+	  int v = verts[i];
+	  long long gain = 0;
+	  for (int k=row_ptr[v]; k<row_ptr[v+1]; k++)
+	    {
+	      int u = cols[k];
+	      if (u==v || label[u]!=my_stamp) continue;
+	      gain += (side[u]!=side[v]) ? adjwgt[k] : -adjwgt[k];
+	    }
+	  if (gain<=0) continue;
+	  long long new_wgt0 = wgt0 + ((side[v]==0) ? -vwgt[v] : vwgt[v]);
+	  if (llabs(new_wgt0-target0)>tol) continue;
+	  side[v] = 1-side[v];
+	  wgt0 = new_wgt0;
+	  moves++;
+	}
+      if (moves==0) break;
+    }
+
+  std::vector<int> verts0, verts1;
+  for (int i=0; i<nv; i++)
+    {
+      if (side[verts[i]]==0) verts0.push_back(verts[i]);
+      else verts1.push_back(verts[i]);
+    }
+  std::vector<int>().swap(verts); // Free before recursing
+
+  recursive_bisection(row_ptr, cols, adjwgt, vwgt, verts0, first_part, nparts0,
+		      part, label, side, visited, stamp);
+  recursive_bisection(row_ptr, cols, adjwgt, vwgt, verts1, first_part+nparts0,
+		      nparts-nparts0, part, label, side, visited, stamp);
+}
+
+void partition_matrix(HPC_Sparse_Matrix *A, double **x, double **b, double **xexact,
+		      long long & edge_cut_before, long long & edge_cut_after,
+		      long long & halo_volume_before, long long & halo_volume_after)
+{
+  int i, j, k, p;
+
+  int size, rank; // Number of MPI processes, My process ID
+  MPI_Comm_size(hpccg_comm, &size);
+  MPI_Comm_rank(hpccg_comm, &rank);
+
+  int start_row = A->start_row;
+  int local_nrow = A->local_nrow;
+  int local_nnz = A->local_nnz;
+  int  * nnz_in_row = A->nnz_in_row;
+  int ** ptr_to_inds_in_row = A->ptr_to_inds_in_row;
+  double ** ptr_to_vals_in_row = A->ptr_to_vals_in_row;
+
+  // Processor p owns original rows row_offsets[p] to row_offsets[p+1]-1
+  std::vector<int> row_offsets(size+1);
+  MPI_Allgather(&local_nrow, 1, MPI_INT, &row_offsets[1], 1, MPI_INT, hpccg_comm);
+  row_offsets[0] = 0;
+  for (p=0; p<size; p++) row_offsets[p+1] += row_offsets[p];
+
+  /////////////////////////////////////////////////////////////////////////
+  // Number the columns: slot[k] of the k-th local nonzero is its local
+  // row, or local_nrow plus its position in ghost_ids for the external
+  // columns.
+  /////////////////////////////////////////////////////////////////////////
+
+  std::vector<int> ghost_ids;
+  for (i=0; i<local_nrow; i++)
+    for (j=0; j<nnz_in_row[i]; j++)
+      {
+	int col = ptr_to_inds_in_row[i][j];
+	if (col<start_row || col>=start_row+local_nrow) ghost_ids.push_back(col);
+      }
+  std::sort(ghost_ids.begin(), ghost_ids.end());
+  ghost_ids.erase(std::unique(ghost_ids.begin(), ghost_ids.end()), ghost_ids.end());
+
+  std::vector<int> slot(local_nnz);
+  for (i=0, k=0; i<local_nrow; i++)
+    for (j=0; j<nnz_in_row[i]; j++, k++)
+      {
+	int col = ptr_to_inds_in_row[i][j];
+	if (col>=start_row && col<start_row+local_nrow)
+	  slot[k] = col-start_row;
+	else
+	  slot[k] = local_nrow + (std::lower_bound(ghost_ids.begin(), ghost_ids.end(), col)
+				  - ghost_ids.begin());
+      }
+
+  /////////////////////////////////////////////////////////////////////////
+  // Coarsen the graph of the local rows, leaving out the diagonal and
+  // the external columns.
+  /////////////////////////////////////////////////////////////////////////
+
+  Local_Graph graph;
+  graph.vwgt.assign(local_nrow, 1);
+  graph.xadj.assign(1, 0);
+  for (i=0, k=0; i<local_nrow; i++)
+    {
+      for (j=0; j<nnz_in_row[i]; j++, k++)
+	if (slot[k]<local_nrow && slot[k]!=i)
+	  {
+	    graph.adj.push_back(slot[k]);
+	    graph.adjwgt.push_back(1);
+	  }
+      graph.xadj.push_back(graph.adj.size());
+    }
+
+  std::vector<int> coarse_of(local_nrow); // Coarse vertex of each local row
+  for (i=0; i<local_nrow; i++) coarse_of[i] = i;
+  // Keep coarse vertices of similar weight so the bisection can balance them
+  int max_vwgt = (int) (1.5*local_nrow/coarse_rows_per_proc) + 1;
+  while ((int) graph.vwgt.size()>coarse_rows_per_proc)
+    {
+      Local_Graph coarse;
+      std::vector<int> cmap;
+      coarsen(graph, max_vwgt, coarse, cmap);
+      bool stalled = coarse.vwgt.size() > 0.95*graph.vwgt.size();
+      for (i=0; i<local_nrow; i++) coarse_of[i] = cmap[coarse_of[i]];
+      std::swap(graph, coarse);
+      if (stalled) break;
+    }
+
+  // Number the coarse vertices globally, and collect the coarse edges,
+  // now including those to the coarse vertices of other processors.
+  int num_coarse = graph.vwgt.size();
+  int coarse_start = 0;
+  MPI_Exscan(&num_coarse, &coarse_start, 1, MPI_INT, MPI_SUM, hpccg_comm);
+  if (rank==0) coarse_start = 0;
+  std::vector<int> global_coarse(local_nrow), ghost_coarse;
+  for (i=0; i<local_nrow; i++) global_coarse[i] = coarse_start + coarse_of[i];
+  fetch_ghost_values(ghost_ids, &row_offsets[0], start_row, global_coarse, ghost_coarse);
+
+  std::vector<long long> edges; // Local coarse vertex in the high word, neighbor in the low
+  for (i=0, k=0; i<local_nrow; i++)
+    for (j=0; j<nnz_in_row[i]; j++, k++)
+      {
+	int s = slot[k];
+	int other = (s<local_nrow) ? global_coarse[s] : ghost_coarse[s-local_nrow];
+	if (other!=global_coarse[i]) edges.push_back((((long long) coarse_of[i])<<32) + other);
+      }
+  std::sort(edges.begin(), edges.end());
+  std::vector<int> coarse_nnz(num_coarse, 0), coarse_adj, coarse_adjwgt;
+  for (size_t e=0; e<edges.size(); e++)
+    {
+      if (e>0 && edges[e]==edges[e-1])
+	{
+	  coarse_adjwgt.back()++;
+	  continue;
+	}
+      coarse_nnz[edges[e]>>32]++;
+      coarse_adj.push_back((int) (edges[e] & 0xffffffffLL));
+      coarse_adjwgt.push_back(1);
+    }
+  std::vector<long long>().swap(edges);
+  std::vector<int>().swap(global_coarse);
+  std::vector<int>().swap(ghost_coarse);
+
+  /////////////////////////////////////////////////////////////////////////
+  // Partition the coarse graph on processor 0 and send each processor
+  // the parts of its own coarse vertices.
+  /////////////////////////////////////////////////////////////////////////
+
+  int local_counts[2] = {num_coarse, (int) coarse_adj.size()};
+  std::vector<int> counts(rank==0 ? 2*size : 0);
+  MPI_Gather(local_counts, 2, MPI_INT, counts.data(), 2, MPI_INT, 0, hpccg_comm);
+  std::vector<int> vert_counts, vert_displs, edge_counts, edge_displs;
+  long long total_coarse = 0, total_edges = 0;
+  if (rank==0)
+    {
+      vert_counts.resize(size); vert_displs.resize(size);
+      edge_counts.resize(size); edge_displs.resize(size);
+      for (p=0; p<size; p++)
+	{
+	  vert_counts[p] = counts[2*p];
+	  edge_counts[p] = counts[2*p+1];
+	  vert_displs[p] = (int) total_coarse;
+	  edge_displs[p] = (int) total_edges;
+	  total_coarse += counts[2*p];
+	  total_edges += counts[2*p+1];
+	  if (total_edges>2147483647LL)
+	    {
+	      cerr << "partition_matrix: coarse graph too large to gather on one processor" << endl;
+	      abort();
+	    }
+	}
+    }
+
+  std::vector<int> all_vwgt(total_coarse), all_nnz(total_coarse);
+  std::vector<int> all_adj(total_edges), all_adjwgt(total_edges);
+  MPI_Gatherv(graph.vwgt.data(), num_coarse, MPI_INT, all_vwgt.data(), vert_counts.data(),
+	      vert_displs.data(), MPI_INT, 0, hpccg_comm);
+  MPI_Gatherv(coarse_nnz.data(), num_coarse, MPI_INT, all_nnz.data(), vert_counts.data(),
+	      vert_displs.data(), MPI_INT, 0, hpccg_comm);
+  MPI_Gatherv(coarse_adj.data(), local_counts[1], MPI_INT, all_adj.data(), edge_counts.data(),
+	      edge_displs.data(), MPI_INT, 0, hpccg_comm);
+  MPI_Gatherv(coarse_adjwgt.data(), local_counts[1], MPI_INT, all_adjwgt.data(),
+	      edge_counts.data(), edge_displs.data(), MPI_INT, 0, hpccg_comm);
+  std::vector<int>().swap(coarse_nnz);
+  std::vector<int>().swap(coarse_adj);
+  std::vector<int>().swap(coarse_adjwgt);
+
+  std::vector<int> coarse_part(total_coarse);
+  if (rank==0)
+    {
+      int n = total_coarse;
+      std::vector<int> row_ptr(n+1);
+      row_ptr[0] = 0;
+      for (i=0; i<n; i++) row_ptr[i+1] = row_ptr[i] + all_nnz[i];
+      std::vector<int> label(n, 0), side(n), visited(n, 0);
+      std::vector<int> verts(n);
+      for (i=0; i<n; i++) verts[i] = i;
+      int stamp = 0;
+      recursive_bisection(row_ptr.data(), all_adj.data(), all_adjwgt.data(), all_vwgt.data(),
+			  verts, 0, size, coarse_part.data(), label.data(), side.data(),
+			  visited.data(), stamp);
+    }
+  std::vector<int>().swap(all_vwgt);
+  std::vector<int>().swap(all_nnz);
+  std::vector<int>().swap(all_adj);
+  std::vector<int>().swap(all_adjwgt);
+
+  std::vector<int> my_coarse_part(num_coarse);
+  MPI_Scatterv(coarse_part.data(), vert_counts.data(), vert_displs.data(), MPI_INT,
+	       my_coarse_part.data(), num_coarse, MPI_INT, 0, hpccg_comm);
+  std::vector<int>().swap(coarse_part);
+
+  std::vector<int> part(local_nrow), ghost_part;
+  for (i=0; i<local_nrow; i++) part[i] = my_coarse_part[coarse_of[i]];
+  fetch_ghost_values(ghost_ids, &row_offsets[0], start_row, part, ghost_part);
+
+  // Quality of the original blocks, where each row stays with its owner
+  std::vector<int> block_part(local_nrow, rank), ghost_block_part(ghost_ids.size());
+  for (size_t g=0, owner=0; g<ghost_ids.size(); g++)
+    {
+      while (ghost_ids[g]>=row_offsets[owner+1]) owner++;
+      ghost_block_part[g] = owner;
+    }
+  partition_quality(local_nrow, start_row, nnz_in_row, slot, ghost_ids, block_part,
+		    ghost_block_part, edge_cut_before, halo_volume_before);
+  partition_quality(local_nrow, start_row, nnz_in_row, slot, ghost_ids, part,
+		    ghost_part, edge_cut_after, halo_volume_after);
+  if (halo_volume_after>=halo_volume_before) // Halo not reduced, keep the original rows
+    {
+      part.swap(block_part);
+      ghost_part.swap(ghost_block_part);
+      edge_cut_after = edge_cut_before;
+      halo_volume_after = halo_volume_before;
+    }
+
+  /////////////////////////////////////////////////////////////////////////
+  // New global numbering: processor p owns a contiguous block of rows,
+  // ordered within the block by their original global index.
+  /////////////////////////////////////////////////////////////////////////
+
+  std::vector<int> part_rows(size, 0), rows_before(size, 0), new_offsets(size+1);
+  for (i=0; i<local_nrow; i++) part_rows[part[i]]++;
+  // Rows of each part on the processors before this one come first
+  MPI_Exscan(part_rows.data(), rows_before.data(), size, MPI_INT, MPI_SUM, hpccg_comm);
+  if (rank==0) for (p=0; p<size; p++) rows_before[p] = 0;
+  MPI_Allreduce(part_rows.data(), &new_offsets[1], size, MPI_INT, MPI_SUM, hpccg_comm);
+  new_offsets[0] = 0;
+  for (p=0; p<size; p++) new_offsets[p+1] += new_offsets[p];
+
+  std::vector<int> new_id(local_nrow), ghost_new_id;
+  for (i=0; i<local_nrow; i++) new_id[i] = new_offsets[part[i]] + rows_before[part[i]]++;
+  fetch_ghost_values(ghost_ids, &row_offsets[0], start_row, new_id, ghost_new_id);
+
+
+  /////////////////////////////////////////////////////////////////////////
+  // Send each row to its new owner
+  /////////////////////////////////////////////////////////////////////////
+
+  int * send_counts = new int[2*size]; // Rows and nonzeros for each destination
+  int * recv_counts = new int[2*size];
+  for (i=0; i<2*size; i++) send_counts[i] = 0;
+  for (i=0; i<local_nrow; i++)
+    {
+      int dest = part[i];
+      send_counts[2*dest]++;
+      send_counts[2*dest+1] += nnz_in_row[i];
+    }
+  MPI_Alltoall(send_counts, 2, MPI_INT, recv_counts, 2, MPI_INT, hpccg_comm);
+
+  int * sc_row = new int[size]; int * sd_row = new int[size];
+  int * rc_row = new int[size]; int * rd_row = new int[size];
+  int * sc_nnz = new int[size]; int * sd_nnz = new int[size];
+  int * rc_nnz = new int[size]; int * rd_nnz = new int[size];
+  for (i=0; i<size; i++)
+    {
+      sc_row[i] = send_counts[2*i]; sc_nnz[i] = send_counts[2*i+1];
+      rc_row[i] = recv_counts[2*i]; rc_nnz[i] = recv_counts[2*i+1];
+      sd_row[i] = (i==0) ? 0 : sd_row[i-1] + sc_row[i-1];
+      sd_nnz[i] = (i==0) ? 0 : sd_nnz[i-1] + sc_nnz[i-1];
+      rd_row[i] = (i==0) ? 0 : rd_row[i-1] + rc_row[i-1];
+      rd_nnz[i] = (i==0) ? 0 : rd_nnz[i-1] + rc_nnz[i-1];
+    }
+  delete [] send_counts;
+  delete [] recv_counts;
+
+  int new_local_nrow = new_offsets[rank+1] - new_offsets[rank];
+  int new_local_nnz = rd_nnz[size-1] + rc_nnz[size-1];
+  assert(new_local_nrow == rd_row[size-1] + rc_row[size-1]);
+
+  // Pack rows by destination, translating indices to the new numbering
+  int * send_rows = new int[2*local_nrow];    // New row id, nnz in row
+  double * send_vecs = new double[3*local_nrow]; // x, b, xexact
+  int * send_inds = new int[local_nnz];
+  double * send_vals = new double[local_nnz];
+  int * row_pos = new int[size];
+  int * nnz_pos = new int[size];
+  for (i=0; i<size; i++) { row_pos[i] = sd_row[i]; nnz_pos[i] = sd_nnz[i]; }
+  for (i=0, k=0; i<local_nrow; i++)
+    {
+      int dest = part[i];
+      int r = row_pos[dest]++;
+      send_rows[2*r] = new_id[i];
+      send_rows[2*r+1] = nnz_in_row[i];
+      send_vecs[3*r] = (*x)[i];
+      send_vecs[3*r+1] = (*b)[i];
+      send_vecs[3*r+2] = (*xexact)[i];
+      for (j=0; j<nnz_in_row[i]; j++, k++)
+	{
+	  int n = nnz_pos[dest]++;
+	  int s = slot[k];
+	  send_inds[n] = (s<local_nrow) ? new_id[s] : ghost_new_id[s-local_nrow];
+	  send_vals[n] = ptr_to_vals_in_row[i][j];
+	}
+    }
+  delete [] row_pos;
+  delete [] nnz_pos;
+
+  int * recv_rows = new int[2*new_local_nrow];
+  double * recv_vecs = new double[3*new_local_nrow];
+  int * new_list_of_inds = tracked_new<int>(new_local_nnz, MEM_INDICES);
+  double * new_list_of_vals = tracked_new<double>(new_local_nnz, MEM_VALUES);
+
+  // Row records and vector entries travel as fixed-size tuples
+  for (i=0; i<size; i++) { sc_row[i] *= 2; sd_row[i] *= 2; rc_row[i] *= 2; rd_row[i] *= 2; }
+  MPI_Alltoallv(send_rows, sc_row, sd_row, MPI_INT, recv_rows, rc_row, rd_row, MPI_INT, hpccg_comm);
+  for (i=0; i<size; i++) { sc_row[i] /= 2; sd_row[i] /= 2; rc_row[i] /= 2; rd_row[i] /= 2; }
+  for (i=0; i<size; i++) { sc_row[i] *= 3; sd_row[i] *= 3; rc_row[i] *= 3; rd_row[i] *= 3; }
+  MPI_Alltoallv(send_vecs, sc_row, sd_row, MPI_DOUBLE, recv_vecs, rc_row, rd_row, MPI_DOUBLE, hpccg_comm);
+  MPI_Alltoallv(send_inds, sc_nnz, sd_nnz, MPI_INT, new_list_of_inds, rc_nnz, rd_nnz, MPI_INT, hpccg_comm);
+  MPI_Alltoallv(send_vals, sc_nnz, sd_nnz, MPI_DOUBLE, new_list_of_vals, rc_nnz, rd_nnz, MPI_DOUBLE, hpccg_comm);
+
+  delete [] send_rows; delete [] send_vecs; delete [] send_inds; delete [] send_vals;
+  delete [] sc_row; delete [] sd_row; delete [] rc_row; delete [] rd_row;
+  delete [] sc_nnz; delete [] sd_nnz; delete [] rc_nnz; delete [] rd_nnz;
+
+  /////////////////////////////////////////////////////////////////////////
+  // Rebuild the local matrix.  Rows arrive grouped by sender, and since
+  // senders own increasing ranges of the original numbering they are
+  // already in new-id order.
+  /////////////////////////////////////////////////////////////////////////
+
+  int new_start_row = new_offsets[rank];
+  int * new_nnz_in_row = tracked_new<int>(new_local_nrow, MEM_ROW_METADATA);
+  double ** new_ptr_to_vals_in_row = tracked_new<double*>(new_local_nrow, MEM_ROW_METADATA);
+  int ** new_ptr_to_inds_in_row = tracked_new<int*>(new_local_nrow, MEM_ROW_METADATA);
+  double ** new_ptr_to_diags = tracked_new<double*>(new_local_nrow, MEM_ROW_METADATA);
+  double * new_x = tracked_new<double>(new_local_nrow, MEM_VECTORS);
+  double * new_b = tracked_new<double>(new_local_nrow, MEM_VECTORS);
+  double * new_xexact = tracked_new<double>(new_local_nrow, MEM_VECTORS);
+
+  int offset = 0;
+  for (i=0; i<new_local_nrow; i++)
+    {
+      int cur_row = recv_rows[2*i];
+      assert(cur_row == new_start_row+i);
+      new_nnz_in_row[i] = recv_rows[2*i+1];
+      new_ptr_to_vals_in_row[i] = new_list_of_vals + offset;
+      new_ptr_to_inds_in_row[i] = new_list_of_inds + offset;
+      new_ptr_to_diags[i] = 0;
+      for (j=0; j<new_nnz_in_row[i]; j++)
+	if (new_list_of_inds[offset+j]==cur_row) new_ptr_to_diags[i] = new_list_of_vals + offset + j;
+      offset += new_nnz_in_row[i];
+      new_x[i] = recv_vecs[3*i];
+      new_b[i] = recv_vecs[3*i+1];
+      new_xexact[i] = recv_vecs[3*i+2];
+    }
+  delete [] recv_rows;
+  delete [] recv_vecs;
+
+  tracked_delete(A->nnz_in_row);
+  tracked_delete(A->ptr_to_vals_in_row);
+  tracked_delete(A->ptr_to_inds_in_row);
+  tracked_delete(A->ptr_to_diags);
+  tracked_delete(A->list_of_vals);
+  tracked_delete(A->list_of_inds);
+  tracked_delete(*x);
+  tracked_delete(*b);
+  tracked_delete(*xexact);
+
+  A->start_row = new_start_row;
+  A->stop_row = new_start_row + new_local_nrow - 1;
+  A->local_nrow = new_local_nrow;
+  A->local_ncol = new_local_nrow;
+  A->local_nnz = new_local_nnz;
+  A->nnz_in_row = new_nnz_in_row;
+  A->ptr_to_vals_in_row = new_ptr_to_vals_in_row;
+  A->ptr_to_inds_in_row = new_ptr_to_inds_in_row;
+  A->ptr_to_diags = new_ptr_to_diags;
+  A->list_of_vals = new_list_of_vals;
+  A->list_of_inds = new_list_of_inds;
+  *x = new_x;
+  *b = new_b;
+  *xexact = new_xexact;
+
+  return;
+}
+#endif // USING_MPI
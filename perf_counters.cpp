@@ -0,0 +1,252 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Routines to count hardware events around the HPCCG kernels, using the
+// Linux perf_event_open system call directly.
+
+// counters_init - Opens a group of counters (cycles, instructions, last
+//                 level cache references and misses) for each OpenMP
+//                 thread.  Events the processor or kernel does not
+//                 provide are skipped; if none can be opened, error is
+//                 set and the other routines do nothing.  Counters only
+//                 follow the thread that opened them, so this must be
+//                 called with the same thread team the kernels use.
+
+// counters_start, counters_stop - Read all counters before and after a
+//                 kernel, adding the difference to that kernel's totals.
+
+// counters_summary - Sums the totals over all processors.  An event is
+//                 reported as available only if every processor has it.
+//                 Must be called by all processors.
+
+/////////////////////////////////////////////////////////////////////////
+
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#ifdef USING_OMP
+#include <omp.h>
+#endif
+#include "perf_counters.hpp"
+#include "hpccg_comm.hpp"
+
+const char * const counter_event_names[counters_num_events] =
+  {"Cycles", "Instructions", "LLC references", "LLC misses"};
+
+#ifdef __linux__
+static int open_event(int event, int group_fd)
+{
+  static const unsigned long long configs[counters_num_events] =
+    {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+     PERF_COUNT_HW_CACHE_REFERENCES, PERF_COUNT_HW_CACHE_MISSES};
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = configs[event];
+  attr.disabled = (group_fd==-1); // The leader starts the whole group
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+    PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return((int) syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+// Reads the group of one thread into values, scaled up if the counters
+// were multiplexed with other users of the PMU.
+static void read_group(HPCCG_Counters * counters, int thread, long long * values)
+{
+  int leader = counters->fd[thread*counters_num_events];
+  unsigned long long buf[3+counters_num_events];
+  if (leader<0 || read(leader, buf, sizeof(buf))<(ssize_t) (4*sizeof(buf[0]))) return;
+  double scale = (buf[2]>0 && buf[2]<buf[1]) ? ((double) buf[1])/buf[2] : 1.0;
+  for (int event=0; event<counters_num_events; event++)
+    {
+      int index = counters->group_index[thread*counters_num_events+event];
+      if (index>=0) values[event] = (long long) (buf[3+index]*scale);
+    }
+}
+#endif
+
+void counters_init(HPCCG_Counters * counters)
+{
+  counters->num_threads = 1;
+#ifdef USING_OMP
+#pragma omp parallel
+#pragma omp master
+  counters->num_threads = omp_get_num_threads();
+#endif
+  int n = counters->num_threads*counters_num_events;
+  counters->fd = new int[n];
+  counters->group_index = new int[n];
+  counters->start = new long long[n];
+  for (int i=0; i<n; i++)
+    {
+      counters->fd[i] = -1;
+      counters->group_index[i] = -1;
+      counters->start[i] = 0;
+    }
+  for (int kernel=0; kernel<trace_num_kernels; kernel++)
+    for (int event=0; event<counters_num_events; event++)
+      counters->totals[kernel][event] = 0;
+  for (int event=0; event<counters_num_events; event++) counters->available[event] = false;
+  counters->error = 0;
+  counters->line_size = 64;
+#ifdef _SC_LEVEL1_DCACHE_LINESIZE
+  long line_size = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+  if (line_size>0) counters->line_size = line_size;
+#endif
+
+#ifdef __linux__
+  int leader_errno = 0;
+#ifdef USING_OMP
+#pragma omp parallel reduction(max:leader_errno)
+#endif
+  {
+#ifdef USING_OMP
+    int thread = omp_get_thread_num();
+#else
+    int thread = 0;
+#endif
+    int * fd = counters->fd + thread*counters_num_events;
+    int * group_index = counters->group_index + thread*counters_num_events;
+    fd[0] = open_event(COUNTER_CYCLES, -1);
+    if (fd[0]<0)
+      leader_errno = errno;
+    else
+      {
+	group_index[0] = 0;
+	int next = 1;
+	for (int event=1; event<counters_num_events; event++)
+	  {
+	    fd[event] = open_event(event, fd[0]);
+	    if (fd[event]>=0) group_index[event] = next++;
+	  }
+	ioctl(fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+      }
+  }
+  if (leader_errno)
+    {
+      if (leader_errno==EACCES || leader_errno==EPERM)
+	counters->error = "Permission denied (see /proc/sys/kernel/perf_event_paranoid)";
+      else if (leader_errno==ENOENT || leader_errno==EOPNOTSUPP || leader_errno==ENODEV)
+	counters->error = "No hardware counters (virtual machine or unsupported processor)";
+      else
+	counters->error = "perf_event_open failed";
+      counters_destroy(counters);
+      return;
+    }
+  for (int event=0; event<counters_num_events; event++)
+    {
+      counters->available[event] = true;
+      for (int thread=0; thread<counters->num_threads; thread++)
+	if (counters->group_index[thread*counters_num_events+event]<0)
+	  counters->available[event] = false;
+    }
+#else
+  counters->error = "Hardware counters require Linux";
+  counters_destroy(counters);
+#endif
+}
+
+void counters_start(HPCCG_Counters * counters)
+{
+#ifdef __linux__
+  if (counters->fd==0) return;
+  for (int thread=0; thread<counters->num_threads; thread++)
+    read_group(counters, thread, counters->start + thread*counters_num_events);
+#endif
+}
+
+void counters_stop(HPCCG_Counters * counters, int kernel)
+{
+#ifdef __linux__
+  if (counters->fd==0) return;
+  long long values[counters_num_events];
+  for (int thread=0; thread<counters->num_threads; thread++)
+    {
+      long long * start = counters->start + thread*counters_num_events;
+      for (int event=0; event<counters_num_events; event++) values[event] = start[event];
+      read_group(counters, thread, values);
+      for (int event=0; event<counters_num_events; event++)
+	counters->totals[kernel][event] += values[event] - start[event];
+    }
+#endif
+}
+
+void counters_summary(HPCCG_Counters * counters,
+		      long long totals[trace_num_kernels][counters_num_events],
+		      bool available[counters_num_events])
+{
+  int local_available[counters_num_events], all_available[counters_num_events];
+  for (int event=0; event<counters_num_events; event++)
+    local_available[event] = counters->available[event];
+#ifdef USING_MPI
+  MPI_Allreduce(counters->totals, totals, trace_num_kernels*counters_num_events,
+		MPI_LONG_LONG, MPI_SUM, hpccg_comm);
+  MPI_Allreduce(local_available, all_available, counters_num_events, MPI_INT, MPI_MIN,
+		hpccg_comm);
+#else
+  memcpy(totals, counters->totals, sizeof(counters->totals));
+  memcpy(all_available, local_available, sizeof(local_available));
+#endif
+  for (int event=0; event<counters_num_events; event++) available[event] = all_available[event];
+}
+
+void counters_destroy(HPCCG_Counters * counters)
+{
+  if (counters->fd==0) return;
+  for (int i=0; i<counters->num_threads*counters_num_events; i++)
+    if (counters->fd[i]>=0) close(counters->fd[i]);
+  delete [] counters->fd;
+  delete [] counters->group_index;
+  delete [] counters->start;
+  counters->fd = 0;
+}
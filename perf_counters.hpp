@@ -0,0 +1,75 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+#ifdef USING_MPI
+#include <mpi.h>
+#endif
+#include "trace.hpp" // For the kernel numbering
+
+// Hardware events counted around each kernel
+enum { COUNTER_CYCLES, COUNTER_INSTRUCTIONS, COUNTER_LLC_REFERENCES, COUNTER_LLC_MISSES,
+       counters_num_events };
+
+extern const char * const counter_event_names[counters_num_events];
+
+struct HPCCG_Counters_STRUCT {
+  int num_threads;
+  int * fd;          // [thread*counters_num_events + event], -1 if not opened
+  int * group_index; // Position of each event in the group read, -1 if not opened
+  bool available[counters_num_events];
+  const char * error; // Why counting is unavailable, 0 if it is
+  int line_size;      // Bytes moved per LLC miss
+  long long * start;  // [thread*counters_num_events + event] at counters_start
+  long long totals[trace_num_kernels][counters_num_events]; // Summed over threads
+};
+typedef struct HPCCG_Counters_STRUCT HPCCG_Counters;
+
+void counters_init(HPCCG_Counters * counters);
+void counters_start(HPCCG_Counters * counters);
+void counters_stop(HPCCG_Counters * counters, int kernel);
+void counters_summary(HPCCG_Counters * counters,
+		      long long totals[trace_num_kernels][counters_num_events],
+		      bool available[counters_num_events]);
+void counters_destroy(HPCCG_Counters * counters);
+#endif
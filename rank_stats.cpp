@@ -0,0 +1,207 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Routines to report load imbalance and communication volume per
+// processor after a solve.
+
+// gather_rank_stats - Collects on processor 0 each processor's kernel
+//                     times (times as returned by HPCCG), nonzeros,
+//                     external entries and bytes sent per halo exchange,
+//                     and the bytes it sends to each neighbor.  Must be
+//                     called by all processors; stats is only filled on
+//                     processor 0.
+
+// add_rank_stats - On processor 0, adds to imbalance the min, average
+//                  and max of each quantity, the max/average ratio and
+//                  the processor with the max, and the values of every
+//                  processor if there are at most max_ranks_listed.
+//                  Adds the communication matrix to comm_matrix, one
+//                  row of "to rank: bytes" per sending processor, or only
+//                  the heaviest links if there are more processors.
+
+/////////////////////////////////////////////////////////////////////////
+
+#ifdef USING_MPI
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include "rank_stats.hpp"
+#include "hpccg_comm.hpp"
+
+const char * const rank_metric_names[rank_num_metrics] =
+  {"Total time", "DDOT time", "WAXPBY time", "SPARSEMV time", "Allreduce time",
+   "Exchange time", "Exchange wait time", "Nonzeros", "External entries",
+   "Bytes sent per exchange"};
+
+// Links listed when the full matrix is too large to print
+const int heaviest_links = 20;
+
+void gather_rank_stats(HPC_Sparse_Matrix * A, const double * times, HPCCG_Rank_Stats & stats)
+{
+  int size, rank;
+  MPI_Comm_size(hpccg_comm, &size);
+  MPI_Comm_rank(hpccg_comm, &rank);
+
+  double nnz = 0.0;
+  for (int i=0; i<A->local_nrow; i++) nnz += A->nnz_in_row[i];
+  double metrics[rank_num_metrics] =
+    {times[0], times[1], times[2], times[3], times[4], times[5], times[7],
+     nnz, (double) A->num_external, sizeof(double)*(double) A->total_to_be_sent};
+
+  int num_links = A->num_send_neighbors;
+  std::vector<int> link_to(num_links+1);
+  std::vector<double> link_bytes(num_links+1);
+  for (int i=0; i<num_links; i++)
+    {
+      link_to[i] = A->neighbors[i];
+      link_bytes[i] = sizeof(double)*(double) A->send_length[i];
+    }
+
+  stats.size = size;
+  stats.metrics = 0;
+  stats.link_offsets = 0;
+  stats.link_to = 0;
+  stats.link_bytes = 0;
+  std::vector<int> num_links_all(size);
+  if (rank==0)
+    {
+      stats.metrics = new double[size*rank_num_metrics];
+      stats.link_offsets = new int[size+1];
+    }
+  MPI_Gather(metrics, rank_num_metrics, MPI_DOUBLE, stats.metrics, rank_num_metrics,
+	     MPI_DOUBLE, 0, hpccg_comm);
+  MPI_Gather(&num_links, 1, MPI_INT, &num_links_all[0], 1, MPI_INT, 0, hpccg_comm);
+  if (rank==0)
+    {
+      stats.link_offsets[0] = 0;
+      for (int r=0; r<size; r++) stats.link_offsets[r+1] = stats.link_offsets[r] + num_links_all[r];
+      stats.link_to = new int[stats.link_offsets[size]+1];
+      stats.link_bytes = new double[stats.link_offsets[size]+1];
+    }
+  MPI_Gatherv(&link_to[0], num_links, MPI_INT, stats.link_to, &num_links_all[0],
+	      stats.link_offsets, MPI_INT, 0, hpccg_comm);
+  MPI_Gatherv(&link_bytes[0], num_links, MPI_DOUBLE, stats.link_bytes, &num_links_all[0],
+	      stats.link_offsets, MPI_DOUBLE, 0, hpccg_comm);
+}
+
+void add_rank_stats(YAML_Element * imbalance, YAML_Element * comm_matrix,
+		    HPCCG_Rank_Stats & stats, int max_ranks_listed)
+{
+  int size = stats.size;
+  char key[64];
+  for (int m=0; m<rank_num_metrics; m++)
+    {
+      double min = stats.metrics[m], max = min, sum = 0.0;
+      int max_rank = 0;
+      for (int r=0; r<size; r++)
+	{
+	  double value = stats.metrics[r*rank_num_metrics+m];
+	  sum += value;
+	  if (value<min) min = value;
+	  if (value>max)
+	    {
+	      max = value;
+	      max_rank = r;
+	    }
+	}
+      double avg = sum/size;
+      YAML_Element * element = imbalance->add(rank_metric_names[m],"");
+      element->add("Min",min);
+      element->add("Avg",avg);
+      element->add("Max",max);
+      element->add("Max/Avg",avg>0.0 ? max/avg : 1.0);
+      element->add("Max rank",max_rank);
+      if (size<=max_ranks_listed)
+	for (int r=0; r<size; r++)
+	  {
+	    sprintf(key, "Rank %d", r);
+	    element->add(key,stats.metrics[r*rank_num_metrics+m]);
+	  }
+    }
+
+  int num_links = stats.link_offsets[size];
+  comm_matrix->add("Links",num_links);
+  if (size<=max_ranks_listed)
+    {
+      for (int r=0; r<size; r++)
+	{
+	  if (stats.link_offsets[r]==stats.link_offsets[r+1]) continue;
+	  sprintf(key, "From rank %d", r);
+	  YAML_Element * row = comm_matrix->add(key,"");
+	  for (int l=stats.link_offsets[r]; l<stats.link_offsets[r+1]; l++)
+	    {
+	      sprintf(key, "To rank %d", stats.link_to[l]);
+	      row->add(key,stats.link_bytes[l]);
+	    }
+	}
+    }
+  else
+    {
+      std::vector<std::pair<double,int> > links(num_links);
+      for (int l=0; l<num_links; l++) links[l] = std::make_pair(stats.link_bytes[l], l);
+      int n = std::min(heaviest_links, num_links);
+      std::partial_sort(links.begin(), links.begin()+n, links.end(),
+			std::greater<std::pair<double,int> >());
+      std::vector<int> from(num_links);
+      for (int r=0; r<size; r++)
+	for (int l=stats.link_offsets[r]; l<stats.link_offsets[r+1]; l++) from[l] = r;
+      YAML_Element * heaviest = comm_matrix->add("Heaviest links","");
+      for (int i=0; i<n; i++)
+	{
+	  int l = links[i].second;
+	  sprintf(key, "Rank %d to rank %d", from[l], stats.link_to[l]);
+	  heaviest->add(key,links[i].first);
+	}
+    }
+}
+
+void free_rank_stats(HPCCG_Rank_Stats & stats)
+{
+  delete [] stats.metrics;
+  delete [] stats.link_offsets;
+  delete [] stats.link_to;
+  delete [] stats.link_bytes;
+}
+#endif // USING_MPI
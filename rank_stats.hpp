@@ -0,0 +1,71 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+#ifndef RANK_STATS_H
+#define RANK_STATS_H
+#ifdef USING_MPI
+#include <mpi.h>
+#include "HPC_Sparse_Matrix.hpp"
+#include "YAML_Element.hpp"
+
+// Per-processor quantities gathered by gather_rank_stats
+enum { RANK_TOTAL_TIME, RANK_DDOT_TIME, RANK_WAXPBY_TIME, RANK_SPARSEMV_TIME,
+       RANK_ALLREDUCE_TIME, RANK_EXCHANGE_TIME, RANK_EXCHANGE_WAIT_TIME,
+       RANK_NNZ, RANK_NUM_EXTERNAL, RANK_BYTES_SENT, rank_num_metrics };
+
+extern const char * const rank_metric_names[rank_num_metrics];
+
+struct HPCCG_Rank_Stats_STRUCT {
+  int size;
+  double * metrics;    // [rank*rank_num_metrics + metric]
+  int * link_offsets;  // Links of rank r are link_offsets[r] .. link_offsets[r+1]-1
+  int * link_to;       // Receiving rank of each link
+  double * link_bytes; // Bytes sent over the link in one halo exchange
+};
+typedef struct HPCCG_Rank_Stats_STRUCT HPCCG_Rank_Stats;
+
+void gather_rank_stats(HPC_Sparse_Matrix * A, const double * times, HPCCG_Rank_Stats & stats);
+void add_rank_stats(YAML_Element * imbalance, YAML_Element * comm_matrix,
+		    HPCCG_Rank_Stats & stats, int max_ranks_listed);
+void free_rank_stats(HPCCG_Rank_Stats & stats);
+#endif
+#endif
@@ -56,6 +56,8 @@ using std::endl;
 #include <cstdio>
 #include <cassert>
 #include "read_HPC_row.hpp"
+#include "tracked_memory.hpp"
+#include "hpccg_comm.hpp"
 void read_HPC_row(char *data_file, HPC_Sparse_Matrix **A,
 		  double **x, double **b, double **xexact)
 
@@ -88,8 +90,8 @@ void read_HPC_row(char *data_file, HPC_Sparse_Matrix **A,
   fscanf(in_file,"%lld",&total_nnz);
 #ifdef USING_MPI
   int size, rank; // Number of MPI processes, My process ID
-  MPI_Comm_size(MPI_COMM_WORLD, &size);
-  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(hpccg_comm, &size);
+  MPI_Comm_rank(hpccg_comm, &rank);
 #else
   int size = 1; // Serial case (not using MPI)
   int rank = 0;
@@ -109,14 +111,14 @@ void read_HPC_row(char *data_file, HPC_Sparse_Matrix **A,
   
 
   // Allocate arrays that are of length local_nrow
-  int *nnz_in_row = new int[local_nrow];
-  double **ptr_to_vals_in_row = new double*[local_nrow];
-  int    **ptr_to_inds_in_row = new int   *[local_nrow];
-  double **ptr_to_diags       = new double*[local_nrow];
+  int *nnz_in_row = tracked_new<int>(local_nrow, MEM_ROW_METADATA);
+  double **ptr_to_vals_in_row = tracked_new<double*>(local_nrow, MEM_ROW_METADATA);
+  int    **ptr_to_inds_in_row = tracked_new<int*>(local_nrow, MEM_ROW_METADATA);
+  double **ptr_to_diags       = tracked_new<double*>(local_nrow, MEM_ROW_METADATA);
 
-  *x = new double[local_nrow];
-  *b = new double[local_nrow];
-  *xexact = new double[local_nrow];
+  *x = tracked_new<double>(local_nrow, MEM_VECTORS);
+  *b = tracked_new<double>(local_nrow, MEM_VECTORS);
+  *xexact = tracked_new<double>(local_nrow, MEM_VECTORS);
 
   // Find nnz for this processor
   int local_nnz = 0;
@@ -136,16 +138,18 @@ void read_HPC_row(char *data_file, HPC_Sparse_Matrix **A,
 
 
   // Allocate arrays that are of length local_nnz
-  double *list_of_vals = new double[local_nnz];
-  int *list_of_inds = new int   [local_nnz];
+  double *list_of_vals = tracked_new<double>(local_nnz, MEM_VALUES);
+  int *list_of_inds = tracked_new<int>(local_nnz, MEM_INDICES);
 
   // Define pointers into list_of_vals/inds 
   ptr_to_vals_in_row[0] = list_of_vals;
   ptr_to_inds_in_row[0] = list_of_inds;
+  ptr_to_diags[0] = 0;
   for (i=1; i<local_nrow; i++)
     {
       ptr_to_vals_in_row[i] = ptr_to_vals_in_row[i-1]+nnz_in_row[i-1];
       ptr_to_inds_in_row[i] = ptr_to_inds_in_row[i-1]+nnz_in_row[i-1];
+      ptr_to_diags[i] = 0;
     }
 
   cur_local_row = 0;
@@ -162,6 +166,7 @@ void read_HPC_row(char *data_file, HPC_Sparse_Matrix **A,
 	      fscanf(in_file, "%lf %d",vp,lp);
 	      ptr_to_vals_in_row[cur_local_row][j] = v;
 	      ptr_to_inds_in_row[cur_local_row][j] = l;
+	      if (l==i) ptr_to_diags[cur_local_row] = ptr_to_vals_in_row[cur_local_row]+j;
 	    }
 	      cur_local_row++;
 	}
@@ -198,7 +203,7 @@ void read_HPC_row(char *data_file, HPC_Sparse_Matrix **A,
 		  <<" has "<<local_nnz<<" nonzeros."<<endl;
 
   *A = new HPC_Sparse_Matrix; // Allocate matrix struct and fill it
-  (*A)->title = 0;
+  initMatrix(*A);
   (*A)->start_row = start_row ; 
   (*A)->stop_row = stop_row;
   (*A)->total_nrow = total_nrow;
@@ -210,6 +215,8 @@ void read_HPC_row(char *data_file, HPC_Sparse_Matrix **A,
   (*A)->ptr_to_vals_in_row = ptr_to_vals_in_row;
   (*A)->ptr_to_inds_in_row = ptr_to_inds_in_row;
   (*A)-> ptr_to_diags = ptr_to_diags;
+  (*A)->list_of_vals = list_of_vals;
+  (*A)->list_of_inds = list_of_inds;
 
   return;
 }
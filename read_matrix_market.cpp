@@ -0,0 +1,503 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Routine to read a sparse matrix in Matrix Market coordinate format.
+
+// data_file - Name of a globally accessible .mtx file.  real, integer
+//             and pattern files are accepted; symmetric files store only
+//             one triangle and are expanded to full storage here.
+
+// x, b, xexact - Initial guess, right hand side and exact solution.
+//                If files named <stem>_b.mtx and <stem>_xexact.mtx (Matrix
+//                Market array format) exist next to data_file they are
+//                used, and <stem>_x0.mtx supplies the initial guess if
+//                present.  Otherwise xexact is all ones, b = A*xexact
+//                and x is zero, as in generate_matrix.  If only one of
+//                the b and xexact files exists it is ignored, with a
+//                warning, since the two must agree.
+
+// Rows are assigned to processors in contiguous blocks, as in
+// read_HPC_row.  Each processor parses an equal share of the file's
+// bytes and sends every entry to the processor that owns its row, so no
+// processor has to scan the whole file.  The vector files are read the
+// same way.  Entries outside the matrix, and files with fewer or more
+// entries than their size line gives, are reported and end the run.
+
+/////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+using std::cout;
+using std::cerr;
+using std::endl;
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "read_matrix_market.hpp"
+#include "tracked_memory.hpp"
+#include "hpccg_comm.hpp"
+
+struct mm_entry {
+  int row, col;
+  double val;
+  bool operator<(const mm_entry & other) const
+  { return row<other.row || (row==other.row && col<other.col); }
+};
+
+// First row owned by processor p when n rows are split into blocks.
+static int block_start(int n, int size, int p)
+{
+  int chunksize = n/size;
+  int remainder = n%size;
+  return(p*chunksize + ((p<remainder) ? p : remainder));
+}
+
+static int block_owner(int n, int size, int row)
+{
+  int chunksize = n/size;
+  int remainder = n%size;
+  int split = remainder*(chunksize+1); // Rows below split are in the bigger blocks
+  if (row<split) return(row/(chunksize+1));
+  return(remainder + (row-split)/chunksize);
+}
+
+// Reads the lines of file_name that start in bytes begin to end-1 into
+// buf, null terminated.  Each line is read by the processor whose share
+// of the bytes holds its first character.
+static void read_lines(const char * file_name, long long begin, long long end,
+		       std::vector<char> & buf)
+{
+  FILE * in_file = fopen(file_name, "r");
+  if (in_file==0)
+    {
+      printf("Error: Cannot open file: %s\n",file_name);
+      exit(1);
+    }
+  buf.resize(end-begin+1);
+  fseek(in_file, begin-1, SEEK_SET);
+  int prev = fgetc(in_file); // A line starting exactly at begin is ours
+  size_t nread = fread(&buf[0], 1, end-begin, in_file);
+  buf.resize(nread);
+  int c;
+  if (nread>0 && buf.back()!='\n')
+    while ((c = fgetc(in_file))!=EOF && c!='\n') buf.push_back((char) c); // Finish last line
+  fclose(in_file);
+
+  size_t first = 0;
+  if (prev!='\n')
+    while (first<buf.size() && buf[first]!='\n') first++; // Partial line belongs to previous processor
+  buf.erase(buf.begin(), buf.begin()+first);
+  buf.push_back('\0');
+}
+
+// Reads a Matrix Market array file of length n and stores entries
+// start_row..start_row+nrow-1 in v, which must be the block of rows
+// owned by this processor.  Returns false on all processors if the file
+// does not exist.
+static bool read_mm_vector(const std::string & name, int n, int start_row, int nrow, double *v)
+{
+#ifdef USING_MPI
+  int size, rank; // Number of MPI processes, My process ID
+  MPI_Comm_size(hpccg_comm, &size);
+  MPI_Comm_rank(hpccg_comm, &rank);
+#else
+  int size = 1; // Serial case (not using MPI)
+  int rank = 0;
+#endif
+
+  // Processor 0 reads the size line.  offsets: exists, length, data start, file size
+  long long offsets[4] = {0, 0, 0, 0};
+  if (rank==0)
+    {
+      FILE * in_file = fopen(name.c_str(), "r");
+      if (in_file!=0)
+	{
+	  char line[1024];
+	  int m = 0, ncols = 0;
+	  while (fgets(line, sizeof(line), in_file))
+	    if (line[0]!='%' && sscanf(line, "%d %d", &m, &ncols)==2) break;
+	  offsets[0] = 1;
+	  offsets[1] = m;
+	  offsets[2] = ftell(in_file);
+	  fseek(in_file, 0, SEEK_END);
+	  offsets[3] = ftell(in_file);
+	  fclose(in_file);
+	}
+    }
+#ifdef USING_MPI
+  MPI_Bcast(offsets, 4, MPI_LONG_LONG, 0, hpccg_comm);
+#endif
+  if (!offsets[0]) return(false);
+  if (offsets[1]!=n)
+    {
+      if (rank==0) cerr << "Error: " << name << " has " << offsets[1] << " entries, expected " << n << endl;
+      exit(1);
+    }
+
+  // Parse the values in this processor's share of the bytes
+  long long data_bytes = offsets[3] - offsets[2];
+  std::vector<char> buf;
+  read_lines(name.c_str(), offsets[2] + (data_bytes*rank)/size,
+	     offsets[2] + (data_bytes*(rank+1))/size, buf);
+  std::vector<double> values;
+  char * cur = &buf[0];
+  while (*cur)
+    {
+      while (*cur=='\n' || *cur=='\r' || *cur==' ' || *cur=='\t') cur++;
+      if (*cur=='\0') break;
+      if (*cur=='%') { while (*cur && *cur!='\n') cur++; continue; }
+      char * token = cur;
+      double t = strtod(token, &cur);
+      if (cur==token)
+	{
+	  cerr << "Error: " << name << " has a value that is not a number" << endl;
+	  exit(1);
+	}
+      values.push_back(t);
+    }
+  std::vector<char>().swap(buf);
+
+  long long count = values.size(), total = count;
+#ifdef USING_MPI
+  long long first = 0; // Value k of this processor is entry first+k of the vector
+  MPI_Exscan(&count, &first, 1, MPI_LONG_LONG, MPI_SUM, hpccg_comm);
+  if (rank==0) first = 0;
+  MPI_Allreduce(&count, &total, 1, MPI_LONG_LONG, MPI_SUM, hpccg_comm);
+#endif
+  if (total!=n)
+    {
+      if (rank==0) cerr << "Error: " << name << " has " << total << " values, expected " << n << endl;
+      exit(1);
+    }
+
+#ifdef USING_MPI
+  // Send each value to the owner of its row
+  std::vector<int> send_counts(size, 0), recv_counts(size);
+  std::vector<int> send_displs(size+1, 0), recv_displs(size+1, 0);
+  for (long long k=0; k<count; k++) send_counts[block_owner(n, size, (int) (first+k))]++;
+  MPI_Alltoall(&send_counts[0], 1, MPI_INT, &recv_counts[0], 1, MPI_INT, hpccg_comm);
+  for (int p=0; p<size; p++)
+    {
+      send_displs[p+1] = send_displs[p] + send_counts[p];
+      recv_displs[p+1] = recv_displs[p] + recv_counts[p];
+    }
+  assert(recv_displs[size]==nrow);
+  MPI_Alltoallv(values.data(), &send_counts[0], &send_displs[0], MPI_DOUBLE,
+		v, &recv_counts[0], &recv_displs[0], MPI_DOUBLE, hpccg_comm);
+#else
+  assert(start_row==0 && count==nrow);
+  for (int i=0; i<nrow; i++) v[i] = values[i];
+#endif
+  return(true);
+}
+
+void read_matrix_market(char *data_file, HPC_Sparse_Matrix **A,
+			double **x, double **b, double **xexact)
+{
+  int i;
+#ifdef USING_MPI
+  int size, rank; // Number of MPI processes, My process ID
+  MPI_Comm_size(hpccg_comm, &size);
+  MPI_Comm_rank(hpccg_comm, &rank);
+#else
+  int size = 1; // Serial case (not using MPI)
+  int rank = 0;
+#endif
+
+  /////////////////////////////////////////////////////////////////////////
+  // Processor 0 reads the banner and size line
+  /////////////////////////////////////////////////////////////////////////
+
+  // header: nrow, ncol, symmetric, pattern, error
+  // offsets: data start, file size, number of entries
+  int header[5] = {0, 0, 0, 0, 0};
+  long long offsets[3] = {0, 0, 0};
+  if (rank==0)
+    {
+      printf("Reading Matrix Market file %s...\n",data_file);
+      FILE * in_file = fopen(data_file, "r");
+      if (in_file==0)
+	{
+	  printf("Error: Cannot open file: %s\n",data_file);
+	  header[4] = 1;
+	}
+      else
+	{
+	  char line[1024], object[64], format[64], field[64], symmetry[64];
+	  if (fgets(line, sizeof(line), in_file)==0 ||
+	      sscanf(line, "%%%%MatrixMarket %63s %63s %63s %63s", object, format, field, symmetry)!=4)
+	    {
+	      printf("Error: %s is not a Matrix Market file\n",data_file);
+	      header[4] = 1;
+	    }
+	  else if (strcmp(format,"coordinate")!=0 || strcmp(field,"complex")==0 ||
+		   (strcmp(symmetry,"general")!=0 && strcmp(symmetry,"symmetric")!=0))
+	    {
+	      printf("Error: Only real general or symmetric coordinate matrices are supported\n");
+	      header[4] = 1;
+	    }
+	  else
+	    {
+	      header[2] = strcmp(symmetry,"symmetric")==0;
+	      header[3] = strcmp(field,"pattern")==0;
+	      do
+		{
+		  if (fgets(line, sizeof(line), in_file)==0) { header[4] = 1; break; }
+		}
+	      while (line[0]=='%' || sscanf(line, "%d %d %lld", header, header+1, offsets+2)!=3);
+	      offsets[0] = ftell(in_file);
+	      fseek(in_file, 0, SEEK_END);
+	      offsets[1] = ftell(in_file);
+	      if (header[0]!=header[1])
+		{
+		  printf("Error: Matrix must be square\n");
+		  header[4] = 1;
+		}
+	    }
+	  fclose(in_file);
+	}
+    }
+#ifdef USING_MPI
+  MPI_Bcast(header, 5, MPI_INT, 0, hpccg_comm);
+  MPI_Bcast(offsets, 3, MPI_LONG_LONG, 0, hpccg_comm);
+#endif
+  if (header[4]) exit(1);
+
+  const int total_nrow = header[0];
+  const bool symmetric = header[2];
+  const bool pattern = header[3];
+
+  /////////////////////////////////////////////////////////////////////////
+  // Each processor parses the lines starting in its share of the bytes
+  /////////////////////////////////////////////////////////////////////////
+
+  long long data_bytes = offsets[1] - offsets[0];
+  std::vector<char> buf;
+  read_lines(data_file, offsets[0] + (data_bytes*rank)/size,
+	     offsets[0] + (data_bytes*(rank+1))/size, buf);
+
+  // counts: entries read, entries that are not valid
+  long long counts[2] = {0, 0};
+  std::vector<mm_entry> entries;
+  std::vector<int> send_counts(size, 0);
+  char * cur = &buf[0];
+  while (*cur)
+    {
+      while (*cur=='\n' || *cur=='\r' || *cur==' ' || *cur=='\t') cur++;
+      if (*cur=='\0') break;
+      if (*cur=='%') { while (*cur && *cur!='\n') cur++; continue; }
+      mm_entry e;
+      char * line = cur;
+      long row = strtol(line, &cur, 10);
+      char * token = cur;
+      long col = strtol(token, &cur, 10);
+      bool valid = cur!=token;
+      if (!pattern)
+	{
+	  token = cur;
+	  e.val = strtod(token, &cur);
+	  valid = valid && cur!=token;
+	}
+      else
+	e.val = 1.0;
+      while (*cur && *cur!='\n') cur++;
+      counts[0]++;
+      if (!valid || row<1 || row>total_nrow || col<1 || col>total_nrow)
+	{
+	  if (counts[1]++==0)
+	    cerr << "Error: " << data_file << " has entry \""
+		 << std::string(line, cur-line) << "\" outside the "
+		 << total_nrow << " x " << total_nrow << " matrix" << endl;
+	  continue;
+	}
+      e.row = (int) row - 1;
+      e.col = (int) col - 1;
+      entries.push_back(e);
+      send_counts[block_owner(total_nrow, size, e.row)]++;
+      if (symmetric && e.row!=e.col)
+	{
+	  std::swap(e.row, e.col);
+	  entries.push_back(e);
+	  send_counts[block_owner(total_nrow, size, e.row)]++;
+	}
+    }
+  std::vector<char>().swap(buf);
+
+  long long total_counts[2] = {counts[0], counts[1]};
+#ifdef USING_MPI
+  MPI_Allreduce(counts, total_counts, 2, MPI_LONG_LONG, MPI_SUM, hpccg_comm);
+#endif
+  if (total_counts[0]!=offsets[2] && rank==0)
+    cerr << "Error: " << data_file << " has " << total_counts[0] << " entries, expected "
+	 << offsets[2] << endl;
+  if (total_counts[1]>0 || total_counts[0]!=offsets[2]) exit(1);
+
+  /////////////////////////////////////////////////////////////////////////
+  // Send each entry to the owner of its row
+  /////////////////////////////////////////////////////////////////////////
+
+#ifdef USING_MPI
+  std::vector<int> recv_counts(size), send_displs(size+1, 0), recv_displs(size+1, 0);
+  MPI_Alltoall(&send_counts[0], 1, MPI_INT, &recv_counts[0], 1, MPI_INT, hpccg_comm);
+  for (i=0; i<size; i++)
+    {
+      send_displs[i+1] = send_displs[i] + send_counts[i];
+      recv_displs[i+1] = recv_displs[i] + recv_counts[i];
+    }
+  std::vector<mm_entry> sorted(entries.size());
+  std::vector<int> pos(send_displs.begin(), send_displs.end()-1);
+  for (size_t k=0; k<entries.size(); k++)
+    sorted[pos[block_owner(total_nrow, size, entries[k].row)]++] = entries[k];
+  std::vector<mm_entry>().swap(entries);
+  entries.resize(recv_displs[size]);
+
+  MPI_Datatype entry_type;
+  MPI_Type_contiguous(sizeof(mm_entry), MPI_BYTE, &entry_type);
+  MPI_Type_commit(&entry_type);
+  MPI_Alltoallv(&sorted[0], &send_counts[0], &send_displs[0], entry_type,
+		&entries[0], &recv_counts[0], &recv_displs[0], entry_type, hpccg_comm);
+  MPI_Type_free(&entry_type);
+  std::vector<mm_entry>().swap(sorted);
+#endif
+
+  /////////////////////////////////////////////////////////////////////////
+  // Assemble local rows, summing any duplicate entries
+  /////////////////////////////////////////////////////////////////////////
+
+  int start_row = block_start(total_nrow, size, rank);
+  int stop_row = block_start(total_nrow, size, rank+1) - 1;
+  int local_nrow = stop_row - start_row + 1;
+
+  std::sort(entries.begin(), entries.end());
+  int local_nnz = 0;
+  for (size_t k=0; k<entries.size(); k++)
+    if (k==0 || entries[k].row!=entries[k-1].row || entries[k].col!=entries[k-1].col) local_nnz++;
+
+  int *nnz_in_row = tracked_new<int>(local_nrow, MEM_ROW_METADATA);
+  double **ptr_to_vals_in_row = tracked_new<double*>(local_nrow, MEM_ROW_METADATA);
+  int    **ptr_to_inds_in_row = tracked_new<int*>(local_nrow, MEM_ROW_METADATA);
+  double **ptr_to_diags       = tracked_new<double*>(local_nrow, MEM_ROW_METADATA);
+  double *list_of_vals = tracked_new<double>(local_nnz, MEM_VALUES);
+  int *list_of_inds = tracked_new<int>(local_nnz, MEM_INDICES);
+
+  *x = tracked_new<double>(local_nrow, MEM_VECTORS);
+  *b = tracked_new<double>(local_nrow, MEM_VECTORS);
+  *xexact = tracked_new<double>(local_nrow, MEM_VECTORS);
+
+  for (i=0; i<local_nrow; i++) { nnz_in_row[i] = 0; ptr_to_diags[i] = 0; }
+  int nz = -1;
+  for (size_t k=0; k<entries.size(); k++)
+    {
+      if (k==0 || entries[k].row!=entries[k-1].row || entries[k].col!=entries[k-1].col)
+	{
+	  nz++;
+	  list_of_vals[nz] = entries[k].val;
+	  list_of_inds[nz] = entries[k].col;
+	  nnz_in_row[entries[k].row-start_row]++;
+	  if (entries[k].row==entries[k].col) ptr_to_diags[entries[k].row-start_row] = list_of_vals+nz;
+	}
+      else
+	list_of_vals[nz] += entries[k].val;
+    }
+  std::vector<mm_entry>().swap(entries);
+
+  int offset = 0;
+  for (i=0; i<local_nrow; i++)
+    {
+      ptr_to_vals_in_row[i] = list_of_vals+offset;
+      ptr_to_inds_in_row[i] = list_of_inds+offset;
+      offset += nnz_in_row[i];
+    }
+
+  long long total_nnz = local_nnz;
+#ifdef USING_MPI
+  long long lnnz = local_nnz;
+  MPI_Allreduce(&lnnz, &total_nnz, 1, MPI_LONG_LONG, MPI_SUM, hpccg_comm);
+#endif
+
+  /////////////////////////////////////////////////////////////////////////
+  // Vectors
+  /////////////////////////////////////////////////////////////////////////
+
+  std::string stem(data_file, strlen(data_file)-4);
+  bool have_b = read_mm_vector(stem+"_b.mtx", total_nrow, start_row, local_nrow, *b);
+  bool have_xexact = read_mm_vector(stem+"_xexact.mtx", total_nrow, start_row, local_nrow, *xexact);
+  if (have_b!=have_xexact && rank==0)
+    cerr << "Warning: ignoring " << stem << (have_b ? "_b.mtx" : "_xexact.mtx") << " since "
+	 << stem << (have_b ? "_xexact.mtx" : "_b.mtx") << " is missing; using xexact = 1"
+	 << " and b = A*xexact" << endl;
+  if (!have_b || !have_xexact)
+    {
+      for (i=0; i<local_nrow; i++)
+	{
+	  (*xexact)[i] = 1.0;
+	  double sum = 0.0;
+	  for (int j=0; j<nnz_in_row[i]; j++) sum += ptr_to_vals_in_row[i][j];
+	  (*b)[i] = sum;
+	}
+    }
+  if (!read_mm_vector(stem+"_x0.mtx", total_nrow, start_row, local_nrow, *x))
+    for (i=0; i<local_nrow; i++) (*x)[i] = 0.0;
+
+  *A = new HPC_Sparse_Matrix; // Allocate matrix struct and fill it
+  initMatrix(*A);
+  (*A)->start_row = start_row ;
+  (*A)->stop_row = stop_row;
+  (*A)->total_nrow = total_nrow;
+  (*A)->total_nnz = total_nnz;
+  (*A)->local_nrow = local_nrow;
+  (*A)->local_ncol = local_nrow;
+  (*A)->local_nnz = local_nnz;
+  (*A)->nnz_in_row = nnz_in_row;
+  (*A)->ptr_to_vals_in_row = ptr_to_vals_in_row;
+  (*A)->ptr_to_inds_in_row = ptr_to_inds_in_row;
+  (*A)->ptr_to_diags = ptr_to_diags;
+  (*A)->list_of_vals = list_of_vals;
+  (*A)->list_of_inds = list_of_inds;
+
+  return;
+}
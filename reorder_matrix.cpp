@@ -0,0 +1,240 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Routines to renumber the local rows (and the matching local columns)
+// of a matrix to improve cache reuse of x in HPC_sparsemv.
+
+// rcm_ordering - Reverse Cuthill-McKee ordering of the local graph.
+
+// morton_ordering - Z-order (Morton) curve through an nx by ny by nz
+//                   grid, for matrices from generate_matrix.
+
+// reorder_matrix - Applies an ordering to A.  External columns (those
+//                  >= local_nrow after make_local_matrix) keep their
+//                  numbering, so exchange_externals is unaffected apart
+//                  from the local indices in elements_to_send.
+
+// permute_vector/unpermute_vector - Move a vector into/out of the new
+//                                   ordering.
+
+// matrix_bandwidth - max |i-j| over local entries.
+
+/////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include "reorder_matrix.hpp"
+#include "tracked_memory.hpp"
+
+void rcm_ordering(HPC_Sparse_Matrix *A, int *new_to_old)
+{
+  const int nrow = A->local_nrow;
+  int i, j;
+
+  // Degree counts only local off-diagonal neighbors
+  std::vector<int> degree(nrow, 0);
+  for (i=0; i<nrow; i++)
+    for (j=0; j<A->nnz_in_row[i]; j++)
+      {
+	int col = A->ptr_to_inds_in_row[i][j];
+	if (col!=i && col<nrow) degree[i]++;
+      }
+
+  std::vector<char> visited(nrow, 0);
+  std::vector<int> nbrs;
+  int count = 0;
+  int next_start = 0;
+  while (count<nrow)
+    {
+      // Start each connected component from an unvisited row of minimum degree
+      while (visited[next_start]) next_start++;
+      int start = next_start;
+      for (i=next_start; i<nrow; i++)
+	if (!visited[i] && degree[i]<degree[start]) start = i;
+
+      int head = count;
+      new_to_old[count++] = start;
+      visited[start] = 1;
+      while (head<count)
+	{
+	  int v = new_to_old[head++];
+	  nbrs.clear();
+	  for (j=0; j<A->nnz_in_row[v]; j++)
+	    {
+	      int col = A->ptr_to_inds_in_row[v][j];
+	      if (col<nrow && !visited[col])
+		{
+		  visited[col] = 1;
+		  nbrs.push_back(col);
+		}
+	    }
+	  // Visit neighbors in order of increasing degree
+	  for (size_t a=1; a<nbrs.size(); a++)
+	    {
+	      int u = nbrs[a];
+	      size_t c = a;
+	      while (c>0 && degree[nbrs[c-1]]>degree[u]) { nbrs[c] = nbrs[c-1]; c--; }
+	      nbrs[c] = u;
+	    }
+	  for (size_t a=0; a<nbrs.size(); a++) new_to_old[count++] = nbrs[a];
+	}
+    }
+
+  std::reverse(new_to_old, new_to_old+nrow);
+}
+
+// Spreads the low 21 bits of v so there are two zero bits between each.
+static unsigned long long spread_bits(unsigned long long v)
+{
+  v &= 0x1fffff;
+  v = (v | v << 32) & 0x1f00000000ffffULL;
+  v = (v | v << 16) & 0x1f0000ff0000ffULL;
+  v = (v | v << 8)  & 0x100f00f00f00f00fULL;
+  v = (v | v << 4)  & 0x10c30c30c30c30c3ULL;
+  v = (v | v << 2)  & 0x1249249249249249ULL;
+  return(v);
+}
+
+void morton_ordering(int nx, int ny, int nz, int *new_to_old)
+{
+  const int nrow = nx*ny*nz;
+  std::vector< std::pair<unsigned long long, int> > keys(nrow);
+  for (int iz=0; iz<nz; iz++)
+    for (int iy=0; iy<ny; iy++)
+      for (int ix=0; ix<nx; ix++)
+	{
+	  int row = iz*nx*ny+iy*nx+ix;
+	  keys[row].first = spread_bits(ix) | spread_bits(iy)<<1 | spread_bits(iz)<<2;
+	  keys[row].second = row;
+	}
+  std::sort(keys.begin(), keys.end());
+  for (int i=0; i<nrow; i++) new_to_old[i] = keys[i].second;
+}
+
+void reorder_matrix(HPC_Sparse_Matrix *A, const int *new_to_old)
+{
+  const int nrow = A->local_nrow;
+  int i, j;
+
+  int * old_to_new = new int[nrow];
+  for (i=0; i<nrow; i++) old_to_new[new_to_old[i]] = i;
+
+  int * nnz_in_row = tracked_new<int>(nrow, MEM_ROW_METADATA);
+  double ** ptr_to_vals_in_row = tracked_new<double*>(nrow, MEM_ROW_METADATA);
+  int ** ptr_to_inds_in_row = tracked_new<int*>(nrow, MEM_ROW_METADATA);
+  double ** ptr_to_diags = tracked_new<double*>(nrow, MEM_ROW_METADATA);
+  double * list_of_vals = tracked_new<double>(A->local_nnz, MEM_VALUES);
+  int * list_of_inds = tracked_new<int>(A->local_nnz, MEM_INDICES);
+
+  int offset = 0;
+  for (i=0; i<nrow; i++)
+    {
+      int old_row = new_to_old[i];
+      int cur_nnz = A->nnz_in_row[old_row];
+      const double * const cur_vals = A->ptr_to_vals_in_row[old_row];
+      const int    * const cur_inds = A->ptr_to_inds_in_row[old_row];
+      nnz_in_row[i] = cur_nnz;
+      ptr_to_diags[i] = 0;
+      for (j=0; j<cur_nnz; j++)
+	{
+	  int col = cur_inds[j];
+	  if (col<nrow) col = old_to_new[col];
+	  list_of_vals[offset+j] = cur_vals[j];
+	  list_of_inds[offset+j] = col;
+	  if (col==i) ptr_to_diags[i] = list_of_vals+offset+j;
+	}
+      ptr_to_vals_in_row[i] = list_of_vals+offset;
+      ptr_to_inds_in_row[i] = list_of_inds+offset;
+      offset += cur_nnz;
+    }
+
+#ifdef USING_MPI
+  for (i=0; i<A->total_to_be_sent; i++)
+    A->elements_to_send[i] = old_to_new[A->elements_to_send[i]];
+#endif
+
+  tracked_delete(A->nnz_in_row);
+  tracked_delete(A->ptr_to_vals_in_row);
+  tracked_delete(A->ptr_to_inds_in_row);
+  tracked_delete(A->ptr_to_diags);
+  tracked_delete(A->list_of_vals);
+  tracked_delete(A->list_of_inds);
+  A->nnz_in_row = nnz_in_row;
+  A->ptr_to_vals_in_row = ptr_to_vals_in_row;
+  A->ptr_to_inds_in_row = ptr_to_inds_in_row;
+  A->ptr_to_diags = ptr_to_diags;
+  A->list_of_vals = list_of_vals;
+  A->list_of_inds = list_of_inds;
+  delete [] old_to_new;
+}
+
+void permute_vector(const int n, const int *new_to_old, double *v)
+{
+  double * tmp = new double[n];
+  for (int i=0; i<n; i++) tmp[i] = v[new_to_old[i]];
+  for (int i=0; i<n; i++) v[i] = tmp[i];
+  delete [] tmp;
+}
+
+void unpermute_vector(const int n, const int *new_to_old, double *v)
+{
+  double * tmp = new double[n];
+  for (int i=0; i<n; i++) tmp[new_to_old[i]] = v[i];
+  for (int i=0; i<n; i++) v[i] = tmp[i];
+  delete [] tmp;
+}
+
+int matrix_bandwidth(HPC_Sparse_Matrix *A)
+{
+  const int nrow = A->local_nrow;
+  int bandwidth = 0;
+  for (int i=0; i<nrow; i++)
+    for (int j=0; j<A->nnz_in_row[i]; j++)
+      {
+	int col = A->ptr_to_inds_in_row[i][j];
+	if (col<nrow && abs(col-i)>bandwidth) bandwidth = abs(col-i);
+      }
+  return(bandwidth);
+}
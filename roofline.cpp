@@ -0,0 +1,165 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Routines for the roofline report: the memory bandwidth the machine
+// can sustain, and the memory traffic the HPCCG kernels cannot avoid.
+
+// stream_bandwidth - Runs a STREAM triad, a[i] = b[i] + s*c[i], on
+//                    vectors of n doubles on all processors at once and
+//                    returns the combined bandwidth in GB/s of the best
+//                    of ntrials.  n should be well beyond the last level
+//                    cache.  Must be called by all processors.
+
+// min_traffic - Bytes that one CG iteration must move between memory and
+//               the processor, summed over all processors, if every
+//               array is read or written exactly once per kernel call:
+//               ddot_bytes - the two dot products, r.r and p.Ap
+//               waxpby_bytes - the three vector updates of p, x and r
+//               sparsemv_bytes - values (1-byte codes or float if A
+//                                has them, which HPC_sparsemv then
+//                                reads; the table of coded values stays
+//                                in cache and is not counted), column
+//                                indices (16-bit in the rows that have
+//                                them) and per-row metadata of A, plus
+//                                x (including external entries) and y;
+//                                or the diagonal and upper triangle, or
+//                                the blocks, if A has them.
+//               Write-allocate traffic and cache misses on x are not
+//               counted, so the real traffic is higher.  Must be called
+//               by all processors.
+
+/////////////////////////////////////////////////////////////////////////
+
+#include "mytimer.hpp"
+#include "block_matrix.hpp"
+#include "roofline.hpp"
+#include "hpccg_comm.hpp"
+
+double stream_bandwidth(int n, int ntrials)
+{
+  double * a = new double[n];
+  double * b = new double[n];
+  double * c = new double[n];
+  // Touch in parallel so pages land near the threads that use them
+#ifdef USING_OMP
+#pragma omp parallel for
+#endif
+  for (int i=0; i<n; i++)
+    {
+      a[i] = 0.0;
+      b[i] = 1.0;
+      c[i] = 2.0;
+    }
+
+  const double scalar = 3.0;
+  double best_time = 0.0;
+  for (int trial=0; trial<ntrials; trial++)
+    {
+#ifdef USING_MPI
+      MPI_Barrier(hpccg_comm); // All processors share the memory system
+#endif
+      double t0 = mytimer();
+#ifdef USING_OMP
+#pragma omp parallel for
+#endif
+      for (int i=0; i<n; i++) a[i] = b[i] + scalar*c[i];
+      double t = mytimer() - t0;
+#ifdef USING_MPI
+      double max_t;
+      MPI_Allreduce(&t, &max_t, 1, MPI_DOUBLE, MPI_MAX, hpccg_comm);
+      t = max_t;
+#endif
+      // The first trial also faults in the pages of a
+      if (trial>0 && (best_time==0.0 || t<best_time)) best_time = t;
+    }
+  if (ntrials<2 || best_time==0.0) best_time = 1.0e-9;
+
+  double bytes = 3.0*sizeof(double)*n;
+#ifdef USING_MPI
+  double local_bytes = bytes;
+  MPI_Allreduce(&local_bytes, &bytes, 1, MPI_DOUBLE, MPI_SUM, hpccg_comm);
+#endif
+  delete [] a;
+  delete [] b;
+  delete [] c;
+  return(bytes/best_time/1.0e9);
+}
+
+void min_traffic(const HPC_Sparse_Matrix * A, double & ddot_bytes,
+		 double & waxpby_bytes, double & sparsemv_bytes)
+{
+  double nrow = A->local_nrow;
+  double ncol = A->local_ncol;
+  double nnz = 0.0; // local_nnz of a generated matrix is only an estimate
+  double short_nnz = 0.0;
+  for (int i=0; i<A->local_nrow; i++)
+    {
+      nnz += A->nnz_in_row[i];
+      if (A->ptr_to_short_inds_in_row && A->ptr_to_short_inds_in_row[i]) short_nnz += A->nnz_in_row[i];
+    }
+  double row_bytes = sizeof(int) + sizeof(double *) + sizeof(int *);
+
+  double bytes[3];
+  bytes[0] = sizeof(double)*(1+2)*nrow;   // r.r reads r once, p.Ap reads two vectors
+  bytes[1] = 3*sizeof(double)*3*nrow;     // Each update reads two vectors and writes one
+  double value_bytes = A->ptr_to_val_codes_in_row ? sizeof(unsigned char)
+    : A->ptr_to_float_vals_in_row ? sizeof(float) : sizeof(double);
+  bytes[2] = (value_bytes+sizeof(int))*nnz - (sizeof(int)-sizeof(short))*short_nnz + row_bytes*nrow
+    + sizeof(double)*(ncol+nrow);
+  if (A->block_row_start)
+    {
+      long long nblocks;
+      bytes[2] = block_matrix_bytes(A, A->block_size, nblocks) + sizeof(double)*(ncol+nrow);
+    }
+  if (A->sym_row_start)
+    bytes[2] = (sizeof(double)+sizeof(int))*(double) A->sym_row_start[A->local_nrow]
+      + (sizeof(double)+sizeof(int))*nrow + sizeof(double)*(ncol+nrow);
+#ifdef USING_MPI
+  double local_bytes[3] = {bytes[0], bytes[1], bytes[2]};
+  MPI_Allreduce(local_bytes, bytes, 3, MPI_DOUBLE, MPI_SUM, hpccg_comm);
+#endif
+  ddot_bytes = bytes[0];
+  waxpby_bytes = bytes[1];
+  sparsemv_bytes = bytes[2];
+}
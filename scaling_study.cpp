@@ -0,0 +1,231 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Routine to run a strong or weak scaling study of HPCCG within one
+// launch, in place of strongScalingRunScript and weakScalingRunScript.
+
+// nx, ny, nz - Sub-block dimensions on each processor at the first
+//              (smallest) point of the study.
+
+// weak - If true, every point keeps the sub-block size, so the global
+//        problem grows with the number of processors.  Otherwise nz is
+//        divided among the processors so the global problem stays the
+//        same; points where it does not divide evenly are skipped.
+
+// rank_counts - Comma-separated numbers of processors for the points,
+//               or 0 for 1, 2, 4, ... up to all of them.
+
+// max_iter - Iterations at each point.
+
+// report - On processor 0, a "Scaling Study" element is added to it with
+//          the time, MFLOPS and parallel efficiency of each point,
+//          relative to the first point.
+
+// Each point runs on a communicator made of the first processors of
+// MPI_COMM_WORLD; the others wait.  Must be called by all processors.
+
+/////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+using std::cerr;
+using std::endl;
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#ifdef USING_MPI
+#include "make_local_matrix.hpp"
+#endif
+#include "generate_matrix.hpp"
+#include "HPCCG.hpp"
+#include "tracked_memory.hpp"
+#include "mytimer.hpp"
+#include "scaling_study.hpp"
+#include "sparsemv_simd.hpp"
+#include "hpccg_comm.hpp"
+
+// Results of one point, as seen by processor 0
+enum { POINT_TOTAL_TIME, POINT_SETUP_TIME, POINT_ITERATIONS, POINT_RESIDUAL,
+       POINT_TOTAL_NROW, POINT_FLOPS, point_num_results };
+
+static void run_point(int nx, int ny, int nz, int max_iter, double * results)
+{
+  HPC_Sparse_Matrix *A;
+  double *x, *b, *xexact;
+  double times[8];
+
+  double t_setup = mytimer();
+  generate_matrix(nx, ny, nz, &A, &x, &b, &xexact);
+#ifdef USING_MPI
+  make_local_matrix(A);
+#endif
+  sparsemv_setup(A);
+  t_setup = mytimer() - t_setup;
+
+  int niters = 0;
+  double normr = 0.0;
+  HPCCG(A, b, x, max_iter, 0.0, niters, normr, times);
+
+  double local_times[2] = {times[0], t_setup}, max_times[2];
+#ifdef USING_MPI
+  MPI_Allreduce(local_times, max_times, 2, MPI_DOUBLE, MPI_MAX, hpccg_comm);
+#else
+  max_times[0] = local_times[0];
+  max_times[1] = local_times[1];
+#endif
+  results[POINT_TOTAL_TIME] = max_times[0];
+  results[POINT_SETUP_TIME] = max_times[1];
+  results[POINT_ITERATIONS] = niters;
+  results[POINT_RESIDUAL] = normr;
+  results[POINT_TOTAL_NROW] = A->total_nrow;
+  // Same operation counts as the report of a single run
+  results[POINT_FLOPS] = niters*(10.0*A->total_nrow + 2.0*A->total_nnz);
+
+  destroyMatrix(A);
+  tracked_delete(x);
+  tracked_delete(b);
+  tracked_delete(xexact);
+}
+
+int scaling_study(int nx, int ny, int nz, bool weak, const char * rank_counts, int max_iter,
+		  YAML_Element * report)
+{
+  int size = 1, rank = 0;
+#ifdef USING_MPI
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+#endif
+
+  std::vector<int> counts;
+  if (rank_counts)
+    {
+      const char * s = rank_counts;
+      while (*s)
+	{
+	  int count = atoi(s);
+	  if (count>=1 && count<=size && (counts.empty() || count>counts.back()))
+	    counts.push_back(count);
+	  else if (rank==0)
+	    cerr << "Scaling study: skipping " << count << " processors" << endl;
+	  while (*s && *s!=',') s++;
+	  if (*s==',') s++;
+	}
+    }
+  else
+    {
+      for (int count=1; count<size; count*=2) counts.push_back(count);
+      counts.push_back(size);
+    }
+  if (counts.empty()) return(-1);
+
+  YAML_Element * study = 0;
+  if (rank==0)
+    {
+      study = report->add("Scaling Study","");
+      study->add("Type",weak ? "Weak" : "Strong");
+      study->add("Iterations per point",max_iter);
+    }
+
+  double base_time = 0.0;
+  int base_count = 0;
+  for (size_t i=0; i<counts.size(); i++)
+    {
+      int count = counts[i];
+      int local_nz = nz;
+      if (!weak)
+	{
+	  long long global_nz = ((long long) nz)*counts[0];
+	  if (global_nz%count)
+	    {
+	      if (rank==0) cerr << "Scaling study: nz*" << counts[0] << " is not divisible by "
+				<< count << ", skipping" << endl;
+	      continue;
+	    }
+	  local_nz = (int) (global_nz/count);
+	}
+
+      double results[point_num_results];
+#ifdef USING_MPI
+      MPI_Comm comm;
+      MPI_Comm_split(MPI_COMM_WORLD, rank<count ? 0 : MPI_UNDEFINED, rank, &comm);
+      if (comm!=MPI_COMM_NULL)
+	{
+	  hpccg_comm = comm;
+	  run_point(nx, ny, local_nz, max_iter, results);
+	  hpccg_comm = MPI_COMM_WORLD;
+	  MPI_Comm_free(&comm);
+	}
+      MPI_Barrier(MPI_COMM_WORLD);
+#else
+      run_point(nx, ny, local_nz, max_iter, results);
+#endif
+      if (rank!=0) continue;
+
+      double time = results[POINT_TOTAL_TIME];
+      if (base_count==0)
+	{
+	  base_time = time;
+	  base_count = count;
+	}
+      char key[64];
+      sprintf(key, "Ranks %d", count);
+      YAML_Element * point = study->add(key,"");
+      point->add("nx",nx);
+      point->add("ny",ny);
+      point->add("nz",local_nz);
+      point->add("Global rows",(long long) results[POINT_TOTAL_NROW]);
+      point->add("Final residual",results[POINT_RESIDUAL]);
+      point->add("Setup time",results[POINT_SETUP_TIME]);
+      point->add("Total time",time);
+      point->add("MFLOPS",results[POINT_FLOPS]/time/1.0E6);
+      point->add("MFLOPS per rank",results[POINT_FLOPS]/time/1.0E6/count);
+      if (weak)
+	point->add("Parallel efficiency",base_time/time);
+      else
+	{
+	  point->add("Speedup",base_time/time*base_count);
+	  point->add("Parallel efficiency",base_time*base_count/(time*count));
+	}
+    }
+  return(0);
+}
@@ -0,0 +1,112 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Routine to compress the column indices of a matrix for HPC_sparsemv.
+
+// In a banded matrix, such as the stencils of generate_matrix, every
+// column is close to the row, so the difference fits in 16 bits and
+// the row index serves as the base: HPC_sparsemv reads x relative to
+// x+i.  Rows that reach further, e.g. to external columns, which are
+// numbered after the local ones, keep their 32-bit indices and are
+// marked by a null pointer.  The 32-bit indices of every row are kept,
+// as the rest of the code uses them.
+
+// The copy is made row by row in parallel (see first touch in
+// tracked_memory.hpp).
+
+/////////////////////////////////////////////////////////////////////////
+
+#include <climits>
+#include <vector>
+#include "short_indices.hpp"
+#include "tracked_memory.hpp"
+
+int make_short_indices(HPC_Sparse_Matrix * A)
+{
+  const int nrow = A->local_nrow;
+  if (A->list_of_short_inds) tracked_delete(A->list_of_short_inds);
+  if (A->ptr_to_short_inds_in_row) tracked_delete(A->ptr_to_short_inds_in_row);
+  A->list_of_short_inds = 0;
+  A->ptr_to_short_inds_in_row = 0;
+
+  // Offsets of the rows that fit, -1 for the others
+  std::vector<long long> offsets(nrow);
+  long long nnz = 0;
+  int num_short_rows = 0;
+  for (int i=0; i<nrow; i++)
+    {
+      bool fits = true;
+      for (int j=0; j<A->nnz_in_row[i] && fits; j++)
+	{
+	  long long offset = (long long) A->ptr_to_inds_in_row[i][j] - i;
+	  fits = offset>=SHRT_MIN && offset<=SHRT_MAX;
+	}
+      offsets[i] = -1;
+      if (!fits) continue;
+      offsets[i] = nnz;
+      nnz += A->nnz_in_row[i];
+      num_short_rows++;
+    }
+  if (num_short_rows==0) return(0);
+
+  short * list_of_short_inds = tracked_new<short>(nnz + short_index_padding, MEM_INDICES);
+  short ** ptr_to_short_inds_in_row = tracked_new<short*>(nrow, MEM_ROW_METADATA);
+#ifdef USING_OMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int i=0; i<nrow; i++)
+    {
+      ptr_to_short_inds_in_row[i] = 0;
+      if (offsets[i]<0) continue;
+      short * const cur_short_inds = list_of_short_inds + offsets[i];
+      for (int j=0; j<A->nnz_in_row[i]; j++)
+	cur_short_inds[j] = (short) (A->ptr_to_inds_in_row[i][j] - i);
+      ptr_to_short_inds_in_row[i] = cur_short_inds;
+    }
+  for (int j=0; j<short_index_padding; j++) list_of_short_inds[nnz+j] = 0;
+
+  A->list_of_short_inds = list_of_short_inds;
+  A->ptr_to_short_inds_in_row = ptr_to_short_inds_in_row;
+  return(num_short_rows);
+}
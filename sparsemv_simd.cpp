@@ -0,0 +1,442 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Specialized versions of HPC_sparsemv: one per instruction set, each
+// also instantiated for the row widths of the generated stencils.
+
+// Each instruction set's kernel is compiled for its own target, so one
+// binary carries all of them and the one to use is chosen at run time
+// from CPUID.  The rows are short (at most 27 entries), so each row is
+// one vector loop with a masked or scalar remainder:
+//   SSE2    - two products per step; SSE2 has no gather, so the two x
+//             values are loaded into one register
+//   AVX2    - four products per step with a 32-bit index gather and FMA
+//   AVX-512 - eight products per step with a gather, and the remainder
+//             done with masked loads instead of a scalar loop
+
+// Every kernel is a template on a row width W.  Rows with exactly W
+// nonzeros call the row loop with the constant W, so the compiler
+// unrolls it completely (27 = 3 AVX-512 steps and a fixed 3-entry
+// mask); other rows, e.g. on the boundary, use the same loop with the
+// run-time count.  W = 0 is the generic kernel.  sparsemv_setup picks W
+// once per matrix.
+
+// The kernels are also templates on the type V of the matrix values.
+// With float values (see make_float_values) each row loads half the
+// value bytes and widens them to double in registers, so x, y and the
+// sums stay double.  With V = unsigned char the rows hold 1-byte codes
+// (see make_value_codes), and the values are looked up in the table:
+// one gather from it per step for AVX2 and AVX-512.  With S set, rows that have 16-bit indices (see
+// make_short_indices) read them instead, as offsets from x+i; the
+// vector kernels widen them to 32 bits for the gather.
+
+// The rows are split over OpenMP threads with the runtime schedule that
+// sparsemv_set_chunk sets: by default the same static partition as the
+// first touch in generate_matrix.
+
+/////////////////////////////////////////////////////////////////////////
+
+#include <cstring>
+#ifdef USING_OMP
+#include <omp.h>
+#endif
+#include "sparsemv_simd.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86
+#include <immintrin.h>
+#endif
+
+const char * const simd_isa_names[simd_num_isas] = {"Scalar", "SSE2", "AVX2", "AVX-512"};
+
+int simd_isa = SIMD_SCALAR;
+bool sparsemv_fixed_width = true;
+int sparsemv_chunk = 0;
+
+int simd_detect_isa()
+{
+#ifdef SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return(SIMD_AVX512);
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return(SIMD_AVX2);
+  if (__builtin_cpu_supports("sse2")) return(SIMD_SSE2);
+#endif
+  return(SIMD_SCALAR);
+}
+
+int simd_select_isa(int isa)
+{
+  int best = simd_detect_isa();
+  simd_isa = isa<best ? isa : best;
+  return(simd_isa);
+}
+
+void sparsemv_setup(HPC_Sparse_Matrix * A)
+{
+  // Widths with a specialized kernel: the 27 and 7-point stencils
+  long long rows_27 = 0, rows_7 = 0;
+  for (int i=0; i<A->local_nrow; i++)
+    {
+      if (A->nnz_in_row[i]==27) rows_27++;
+      else if (A->nnz_in_row[i]==7) rows_7++;
+    }
+  sparsemv_set_chunk(sparsemv_chunk);
+  A->row_width = 0;
+  if (!sparsemv_fixed_width) return;
+  if (2*rows_27>=A->local_nrow && rows_27>0) A->row_width = 27;
+  else if (2*rows_7>=A->local_nrow && rows_7>0) A->row_width = 7;
+}
+
+void sparsemv_set_chunk(int chunk)
+{
+  sparsemv_chunk = chunk;
+#ifdef USING_OMP
+  if (chunk>0) omp_set_schedule(omp_sched_dynamic, chunk);
+  else omp_set_schedule(omp_sched_static, 0);
+#endif
+}
+
+#ifdef USING_OMP
+#define OMP_FOR_ROWS _Pragma("omp parallel for schedule(runtime)")
+#else
+#define OMP_FOR_ROWS
+#endif
+
+// Position in a row of value codes, read like a pointer to the values
+struct code_ptr {
+  const unsigned char * codes;
+  const double * table;
+  code_ptr operator+(int j) const
+  {
+    code_ptr p = {codes+j, table};
+    return(p);
+  }
+  double operator[](int j) const { return(table[codes[j]]); }
+};
+
+// Rows of A's values of type V: vals[i] points to the values of row i
+template <class V> struct value_rows {
+  V ** rows;
+  value_rows(HPC_Sparse_Matrix * A);
+  const V * operator[](int i) const { return(rows[i]); }
+};
+template <> inline value_rows<double>::value_rows(HPC_Sparse_Matrix * A)
+  : rows(A->ptr_to_vals_in_row) {}
+template <> inline value_rows<float>::value_rows(HPC_Sparse_Matrix * A)
+  : rows(A->ptr_to_float_vals_in_row) {}
+template <> struct value_rows<unsigned char> {
+  unsigned char ** rows;
+  const double * table;
+  value_rows(HPC_Sparse_Matrix * A) : rows(A->ptr_to_val_codes_in_row), table(A->val_table) {}
+  code_ptr operator[](int i) const
+  {
+    code_ptr p = {rows[i], table};
+    return(p);
+  }
+};
+
+// Applies the row loop ROW of one instruction set to every row, with
+// the width W as a constant for rows that have it, and the 16-bit
+// indices if S is set and the row has them
+#define SPARSEMV_ROW(ROW, INDS, X)					\
+  if (W>0 && cur_nnz==W) y[i] = ROW(vals[i], INDS, W, X);		\
+  else y[i] = ROW(vals[i], INDS, cur_nnz, X);
+#define SPARSEMV_ROWS(ROW)						\
+  const int nrow = A->local_nrow;					\
+  const value_rows<V> vals(A);						\
+  short ** const short_inds = A->ptr_to_short_inds_in_row;		\
+  OMP_FOR_ROWS							\
+  for (int i=0; i<nrow; i++)						\
+    {									\
+      const int cur_nnz = A->nnz_in_row[i];				\
+      if (S && short_inds[i]) { SPARSEMV_ROW(ROW, short_inds[i], x+i) }	\
+      else { SPARSEMV_ROW(ROW, A->ptr_to_inds_in_row[i], x) }		\
+    }
+
+template <class P, class I> static inline __attribute__((always_inline))
+double row_scalar(const P cur_vals, const I * const cur_inds, const int cur_nnz,
+		  const double * const x)
+{
+  double sum = 0.0;
+  for (int j=0; j<cur_nnz; j++) sum += cur_vals[j]*x[cur_inds[j]];
+  return(sum);
+}
+
+template <int W, class V, bool S>
+static void sparsemv_scalar(HPC_Sparse_Matrix * A, const double * const x, double * const y)
+{
+  SPARSEMV_ROWS(row_scalar)
+}
+
+#ifdef SIMD_X86
+
+// Two values, widened if they are float
+static inline __attribute__((always_inline, target("sse2")))
+__m128d load2(const double * const p)
+{
+  return(_mm_loadu_pd(p));
+}
+static inline __attribute__((always_inline, target("sse2")))
+__m128d load2(const float * const p)
+{
+  return(_mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i *) p))));
+}
+static inline __attribute__((always_inline, target("sse2")))
+__m128d load2(const code_ptr p)
+{
+  return(_mm_setr_pd(p[0], p[1]));
+}
+
+template <class P, class I> static inline __attribute__((always_inline, target("sse2")))
+double row_sse2(const P cur_vals, const I * const cur_inds, const int cur_nnz,
+		const double * const x)
+{
+  __m128d sum = _mm_setzero_pd();
+  int j = 0;
+  for (; j+2<=cur_nnz; j+=2)
+    {
+      __m128d xv = _mm_loadh_pd(_mm_load_sd(x+cur_inds[j]), x+cur_inds[j+1]);
+      sum = _mm_add_pd(sum, _mm_mul_pd(load2(cur_vals+j), xv));
+    }
+  double result = _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+  for (; j<cur_nnz; j++) result += cur_vals[j]*x[cur_inds[j]];
+  return(result);
+}
+
+template <int W, class V, bool S> __attribute__((target("sse2")))
+static void sparsemv_sse2(HPC_Sparse_Matrix * A, const double * const x, double * const y)
+{
+  SPARSEMV_ROWS(row_sse2)
+}
+
+static inline __attribute__((always_inline, target("avx2,fma")))
+__m256d load4(const double * const p)
+{
+  return(_mm256_loadu_pd(p));
+}
+static inline __attribute__((always_inline, target("avx2,fma")))
+__m256d load4(const float * const p)
+{
+  return(_mm256_cvtps_pd(_mm_loadu_ps(p)));
+}
+static inline __attribute__((always_inline, target("avx2,fma")))
+__m256d load4(const code_ptr p)
+{
+  int codes;
+  memcpy(&codes, p.codes, sizeof(codes));
+  __m128i idx = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(codes));
+  const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+  return(_mm256_mask_i32gather_pd(_mm256_setzero_pd(), p.table, idx, all, 8));
+}
+
+// Four indices, widened to 32 bits if they are short
+static inline __attribute__((always_inline, target("avx2,fma")))
+__m128i load4_inds(const int * const p)
+{
+  return(_mm_loadu_si128((const __m128i *) p));
+}
+static inline __attribute__((always_inline, target("avx2,fma")))
+__m128i load4_inds(const short * const p)
+{
+  return(_mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i *) p)));
+}
+
+template <class P, class I> static inline __attribute__((always_inline, target("avx2,fma")))
+double row_avx2(const P cur_vals, const I * const cur_inds, const int cur_nnz,
+		const double * const x)
+{
+  const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+  __m256d sum = _mm256_setzero_pd();
+  int j = 0;
+  for (; j+4<=cur_nnz; j+=4)
+    {
+      __m128i idx = load4_inds(cur_inds+j);
+      __m256d xv = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), x, idx, all, 8);
+      sum = _mm256_fmadd_pd(load4(cur_vals+j), xv, sum);
+    }
+  __m128d half = _mm_add_pd(_mm256_castpd256_pd128(sum), _mm256_extractf128_pd(sum, 1));
+  double result = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+  for (; j<cur_nnz; j++) result += cur_vals[j]*x[cur_inds[j]];
+  return(result);
+}
+
+template <int W, class V, bool S> __attribute__((target("avx2,fma")))
+static void sparsemv_avx2(HPC_Sparse_Matrix * A, const double * const x, double * const y)
+{
+  SPARSEMV_ROWS(row_avx2)
+}
+
+// Eight values, or the lanes of the remainder selected by mask (and
+// lanes, the same mask for AVX2 loads).  Codes are read a full
+// register at a time, which the padding after the last row allows.  The float conversions are
+// masked for the same reason as the shuffles in row_avx512.
+static inline __attribute__((always_inline, target("avx512f,avx2")))
+__m512d load8(const double * const p)
+{
+  return(_mm512_loadu_pd(p));
+}
+static inline __attribute__((always_inline, target("avx512f,avx2")))
+__m512d load8(const float * const p)
+{
+  return(_mm512_maskz_cvtps_pd(0xff, _mm256_loadu_ps(p)));
+}
+static inline __attribute__((always_inline, target("avx512f,avx2")))
+__m512d load8(const code_ptr p)
+{
+  __m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) p.codes));
+  return(_mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xff, idx, p.table, 8));
+}
+static inline __attribute__((always_inline, target("avx512f,avx2")))
+__m512d load8(const double * const p, __mmask8 mask, __m256i)
+{
+  return(_mm512_maskz_loadu_pd(mask, p));
+}
+static inline __attribute__((always_inline, target("avx512f,avx2")))
+__m512d load8(const float * const p, __mmask8 mask, __m256i lanes)
+{
+  return(_mm512_maskz_cvtps_pd(mask, _mm256_maskload_ps(p, lanes)));
+}
+static inline __attribute__((always_inline, target("avx512f,avx2")))
+__m512d load8(const code_ptr p, __mmask8 mask, __m256i)
+{
+  __m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) p.codes));
+  return(_mm512_mask_i32gather_pd(_mm512_setzero_pd(), mask, idx, p.table, 8));
+}
+
+// Eight indices, or the lanes of the remainder.  A full register of
+// shorts is loaded even then, which the padding after the last row
+// allows; the gather's mask skips the extra lanes.
+static inline __attribute__((always_inline, target("avx512f,avx2")))
+__m256i load8_inds(const int * const p)
+{
+  return(_mm256_loadu_si256((const __m256i *) p));
+}
+static inline __attribute__((always_inline, target("avx512f,avx2")))
+__m256i load8_inds(const short * const p)
+{
+  return(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) p)));
+}
+static inline __attribute__((always_inline, target("avx512f,avx2")))
+__m256i load8_inds(const int * const p, __m256i lanes)
+{
+  return(_mm256_maskload_epi32(p, lanes));
+}
+static inline __attribute__((always_inline, target("avx512f,avx2")))
+__m256i load8_inds(const short * const p, __m256i)
+{
+  return(load8_inds(p));
+}
+
+template <class P, class I> static inline __attribute__((always_inline, target("avx512f,avx2")))
+double row_avx512(const P cur_vals, const I * const cur_inds, const int cur_nnz,
+		  const double * const x)
+{
+  __m512d sum = _mm512_setzero_pd();
+  int j = 0;
+  for (; j+8<=cur_nnz; j+=8)
+    {
+      __m256i idx = load8_inds(cur_inds+j);
+      __m512d xv = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xff, idx, x, 8);
+      sum = _mm512_fmadd_pd(load8(cur_vals+j), xv, sum);
+    }
+  if (j<cur_nnz)
+    {
+      __mmask8 mask = (__mmask8) ((1u<<(cur_nnz-j))-1);
+      // AVX2 masked load, as the AVX-512 one for 8 ints needs AVX-512VL
+      __m256i lanes = _mm256_cmpgt_epi32(_mm256_set1_epi32(cur_nnz-j),
+					 _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+      __m256i idx = load8_inds(cur_inds+j, lanes);
+      __m512d xv = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), mask, idx, x, 8);
+      sum = _mm512_fmadd_pd(load8(cur_vals+j, mask, lanes), xv, sum);
+    }
+  // Sum the lanes with in-register shuffles.  The masked forms are
+  // used because GCC's unmasked ones draw uninitialized warnings.
+  sum = _mm512_add_pd(sum, _mm512_mask_shuffle_f64x2(sum, 0xff, sum, sum, 0x4e));
+  sum = _mm512_add_pd(sum, _mm512_mask_shuffle_f64x2(sum, 0xff, sum, sum, 0xb1));
+  sum = _mm512_add_pd(sum, _mm512_mask_permute_pd(sum, 0xff, sum, 0x55));
+  return(_mm512_cvtsd_f64(sum));
+}
+
+template <int W, class V, bool S> __attribute__((target("avx512f,avx2")))
+static void sparsemv_avx512(HPC_Sparse_Matrix * A, const double * const x, double * const y)
+{
+  SPARSEMV_ROWS(row_avx512)
+}
+
+#endif // SIMD_X86
+
+// Instantiates KERNEL for the matrix's row width, value type and
+// index type.  The codes hold the values exactly, so they are used
+// whenever A has them.
+#define SPARSEMV_WIDTH(KERNEL, V, S)					\
+  switch (A->row_width)							\
+    {									\
+    case 27: KERNEL<27, V, S>(A, x, y); break;				\
+    case 7:  KERNEL<7, V, S>(A, x, y); break;				\
+    default: KERNEL<0, V, S>(A, x, y); break;				\
+    }
+#define SPARSEMV_INDS(KERNEL, V)					\
+  if (short_inds) { SPARSEMV_WIDTH(KERNEL, V, true) }			\
+  else { SPARSEMV_WIDTH(KERNEL, V, false) }
+#define SPARSEMV_FORMAT(KERNEL)						\
+  if (val_codes) { SPARSEMV_INDS(KERNEL, unsigned char) }		\
+  else if (float_vals) { SPARSEMV_INDS(KERNEL, float) }		\
+  else { SPARSEMV_INDS(KERNEL, double) }
+
+int sparsemv_simd(HPC_Sparse_Matrix * A, const double * const x, double * const y,
+		  bool float_vals)
+{
+  bool short_inds = A->ptr_to_short_inds_in_row!=0;
+  bool val_codes = A->ptr_to_val_codes_in_row!=0;
+  switch (simd_isa)
+    {
+#ifdef SIMD_X86
+    case SIMD_SSE2:   SPARSEMV_FORMAT(sparsemv_sse2); break;
+    case SIMD_AVX2:   SPARSEMV_FORMAT(sparsemv_avx2); break;
+    case SIMD_AVX512: SPARSEMV_FORMAT(sparsemv_avx512); break;
+#endif
+    default:          SPARSEMV_FORMAT(sparsemv_scalar); break;
+    }
+  return(0);
+}
@@ -0,0 +1,87 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+#ifndef SPARSEMV_SIMD_H
+#define SPARSEMV_SIMD_H
+#include "HPC_Sparse_Matrix.hpp"
+
+// Instruction sets HPC_sparsemv can use, in increasing order
+enum { SIMD_SCALAR, SIMD_SSE2, SIMD_AVX2, SIMD_AVX512, simd_num_isas };
+
+extern const char * const simd_isa_names[simd_num_isas];
+
+// Best instruction set this processor supports, from CPUID
+int simd_detect_isa();
+
+// Makes HPC_sparsemv use isa, or the best supported one below it.
+// Returns the instruction set selected.
+int simd_select_isa(int isa);
+
+// Instruction set HPC_sparsemv currently uses
+extern int simd_isa;
+
+// Picks the row width A's kernels are specialized for (A->row_width):
+// 27 or 7 if at least half of the rows have that many nonzeros and
+// sparsemv_fixed_width is set, otherwise 0, and sets the schedule for
+// sparsemv_chunk.  Call once the matrix is final, before the solve.
+void sparsemv_setup(HPC_Sparse_Matrix * A);
+
+// Whether sparsemv_setup may choose a fixed row width
+extern bool sparsemv_fixed_width;
+
+// Rows (block rows for blocks) per chunk of a dynamic schedule of
+// HPC_sparsemv's loops over OpenMP threads, or 0, the default, for the
+// static partition that matches the first touch of the matrix
+extern int sparsemv_chunk;
+
+// Sets sparsemv_chunk and, with OpenMP, the runtime schedule that
+// HPC_sparsemv's loops use, so the kernels need not set it on every
+// call.  Those are the only schedule(runtime) loops in the code.
+void sparsemv_set_chunk(int chunk);
+
+// y = Ax with the rows vectorized for simd_isa and unrolled for
+// A->row_width, from A's value codes if it has them, else its float
+// values if float_vals is set, and its 16-bit indices if it has them;
+// used by HPC_sparsemv unless all of these are off
+int sparsemv_simd(HPC_Sparse_Matrix * A, const double * const x, double * const y,
+		  bool float_vals);
+#endif
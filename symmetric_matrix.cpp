@@ -0,0 +1,271 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Routines to store a symmetric matrix as its upper triangle and
+// multiply by it, reading about half the bytes of HPC_sparsemv.
+
+// make_symmetric_matrix - Checks that every local off-diagonal entry
+//                         a_ij has an equal a_ji, then copies the
+//                         diagonal, and the entries of each row with a
+//                         column above it.  External columns are all
+//                         above the local rows, so every external entry
+//                         is kept and applied once; its transpose
+//                         belongs to the processor that owns the
+//                         column.  The rows are copied in parallel (see
+//                         first touch in tracked_memory.hpp).  The full
+//                         matrix is kept; add_matrix_format frees it
+//                         once the other formats are made.
+
+// sparsemv_symmetric - Row i adds a_ij x_j to y_i and a_ij x_i to y_j.
+//                      With OpenMP the rows are split into one
+//                      contiguous block per thread.  A thread adds to
+//                      the rows of its own block directly, and to the
+//                      rows after it into a buffer of its own, which
+//                      only needs to reach as far as the highest
+//                      column of its block (sym_reach).  After a
+//                      barrier each thread adds the buffers of the
+//                      blocks before it that reach into its own.  The
+//                      blocks and buffers are laid out by
+//                      make_symmetric_matrix and kept with the matrix;
+//                      they are only laid out again if the number of
+//                      threads changes.
+
+/////////////////////////////////////////////////////////////////////////
+
+#ifdef USING_OMP
+#include <omp.h>
+#endif
+#include "symmetric_matrix.hpp"
+#include "tracked_memory.hpp"
+
+// Whether row j has column i with value a
+static bool has_entry(const HPC_Sparse_Matrix * A, int j, int i, double a)
+{
+  const int * const cur_inds = A->ptr_to_inds_in_row[j];
+  const double * const cur_vals = A->ptr_to_vals_in_row[j];
+  for (int k=0; k<A->nnz_in_row[j]; k++)
+    if (cur_inds[k]==i) return(cur_vals[k]==a);
+  return(false);
+}
+
+// Splits the rows into nblocks blocks, one per thread, and sizes the
+// buffer of each to reach the highest column of its block
+static void partition_blocks(HPC_Sparse_Matrix * A, int nblocks)
+{
+  const int nrow = A->local_nrow;
+  if (A->sym_block_start) tracked_delete(A->sym_block_start);
+  if (A->sym_buffer_start) tracked_delete(A->sym_buffer_start);
+  int * block_start = tracked_new<int>(nblocks+1, MEM_ROW_METADATA);
+  long long * buffer_start = tracked_new<long long>(nblocks+1, MEM_ROW_METADATA);
+  buffer_start[0] = 0;
+  for (int b=0; b<=nblocks; b++)
+    block_start[b] = (int) (((long long) nrow*b)/nblocks);
+  for (int b=0; b<nblocks; b++)
+    {
+      long long length = 0;
+      int end = block_start[b+1];
+      if (end>block_start[b]) length = A->sym_reach[end-1]+1 - end;
+      if (length<0) length = 0;
+      buffer_start[b+1] = buffer_start[b] + length;
+    }
+  if (buffer_start[nblocks]>A->sym_buffer_size)
+    {
+      if (A->sym_buffer) tracked_delete(A->sym_buffer);
+      A->sym_buffer = tracked_new<double>(buffer_start[nblocks], MEM_VECTORS);
+      A->sym_buffer_size = buffer_start[nblocks];
+    }
+  A->sym_nblocks = nblocks;
+  A->sym_block_start = block_start;
+  A->sym_buffer_start = buffer_start;
+}
+
+static int num_blocks()
+{
+#ifdef USING_OMP
+  return(omp_get_max_threads());
+#else
+  return(1);
+#endif
+}
+
+bool make_symmetric_matrix(HPC_Sparse_Matrix * A)
+{
+  const int nrow = A->local_nrow;
+  if (A->sym_diags) tracked_delete(A->sym_diags);
+  if (A->sym_row_start) tracked_delete(A->sym_row_start);
+  if (A->list_of_sym_vals) tracked_delete(A->list_of_sym_vals);
+  if (A->list_of_sym_inds) tracked_delete(A->list_of_sym_inds);
+  if (A->sym_reach) tracked_delete(A->sym_reach);
+  A->sym_diags = 0;
+  A->sym_row_start = 0;
+  A->list_of_sym_vals = 0;
+  A->list_of_sym_inds = 0;
+  A->sym_reach = 0;
+
+  int symmetric = 1;
+#ifdef USING_OMP
+#pragma omp parallel for schedule(static) reduction(&&:symmetric)
+#endif
+  for (int i=0; i<nrow; i++)
+    for (int k=0; k<A->nnz_in_row[i]; k++)
+      {
+	int j = A->ptr_to_inds_in_row[i][k];
+	if (j<nrow && j!=i && !has_entry(A, j, i, A->ptr_to_vals_in_row[i][k])) symmetric = 0;
+      }
+  if (!symmetric) return(false);
+
+  int * sym_row_start = tracked_new<int>(nrow+1, MEM_ROW_METADATA);
+  int * sym_reach = tracked_new<int>(nrow, MEM_ROW_METADATA);
+  sym_row_start[0] = 0;
+  int reach = -1;
+  for (int i=0; i<nrow; i++)
+    {
+      int nnz = 0;
+      for (int k=0; k<A->nnz_in_row[i]; k++)
+	{
+	  int j = A->ptr_to_inds_in_row[i][k];
+	  if (j<=i) continue;
+	  nnz++;
+	  if (j<nrow && j>reach) reach = j;
+	}
+      sym_row_start[i+1] = sym_row_start[i] + nnz;
+      if (i>reach) reach = i;
+      sym_reach[i] = reach;
+    }
+
+  double * sym_diags = tracked_new<double>(nrow, MEM_VALUES);
+  double * list_of_sym_vals = tracked_new<double>(sym_row_start[nrow], MEM_VALUES);
+  int * list_of_sym_inds = tracked_new<int>(sym_row_start[nrow], MEM_INDICES);
+#ifdef USING_OMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int i=0; i<nrow; i++)
+    {
+      const double * const cur_vals = A->ptr_to_vals_in_row[i];
+      const int * const cur_inds = A->ptr_to_inds_in_row[i];
+      int offset = sym_row_start[i];
+      sym_diags[i] = 0.0;
+      for (int k=0; k<A->nnz_in_row[i]; k++)
+	{
+	  int j = cur_inds[k];
+	  if (j==i) sym_diags[i] = cur_vals[k];
+	  if (j<=i) continue;
+	  list_of_sym_vals[offset] = cur_vals[k];
+	  list_of_sym_inds[offset] = j;
+	  offset++;
+	}
+    }
+
+  A->sym_diags = sym_diags;
+  A->sym_row_start = sym_row_start;
+  A->list_of_sym_vals = list_of_sym_vals;
+  A->list_of_sym_inds = list_of_sym_inds;
+  A->sym_reach = sym_reach;
+  partition_blocks(A, num_blocks());
+  return(true);
+}
+
+int sparsemv_symmetric(HPC_Sparse_Matrix * A, const double * const x, double * const y)
+{
+  const int nrow = A->local_nrow;
+  const double * const diags = A->sym_diags;
+  const int * const row_start = A->sym_row_start;
+  const double * const vals = A->list_of_sym_vals;
+  const int * const inds = A->list_of_sym_inds;
+
+  if (A->sym_nblocks!=num_blocks()) partition_blocks(A, num_blocks());
+  const int nblocks = A->sym_nblocks;
+  // Block b is rows block_start[b] to block_start[b+1]-1; its buffer
+  // starts at buffer_start[b], for rows block_start[b+1] on
+  const int * const block_start = A->sym_block_start;
+  const long long * const buffer_start = A->sym_buffer_start;
+  double * const buffer = A->sym_buffer;
+
+#ifdef USING_OMP
+#pragma omp parallel num_threads(nblocks)
+#endif
+  {
+#ifdef USING_OMP
+    const int first_block = omp_get_thread_num();
+    const int block_stride = omp_get_num_threads();
+#else
+    const int first_block = 0;
+    const int block_stride = 1;
+#endif
+    for (int b=first_block; b<nblocks; b+=block_stride)
+      {
+	const int start = block_start[b], end = block_start[b+1];
+	double * const cur_buffer = buffer + buffer_start[b] - end;
+	for (int i=start; i<end; i++) y[i] = 0.0;
+	for (long long r=buffer_start[b]; r<buffer_start[b+1]; r++) buffer[r] = 0.0;
+	for (int i=start; i<end; i++)
+	  {
+	    const double xi = x[i];
+	    double sum = diags[i]*xi;
+	    for (int k=row_start[i]; k<row_start[i+1]; k++)
+	      {
+		const int j = inds[k];
+		sum += vals[k]*x[j];
+		if (j<end) y[j] += vals[k]*xi;
+		else if (j<nrow) cur_buffer[j] += vals[k]*xi;
+	      }
+	    y[i] += sum;
+	  }
+      }
+#ifdef USING_OMP
+#pragma omp barrier
+#endif
+    for (int b=first_block; b<nblocks; b+=block_stride)
+      {
+	const int start = block_start[b], end = block_start[b+1];
+	for (int c=0; c<b; c++)
+	  {
+	    const int buffer_end = block_start[c+1] + (int) (buffer_start[c+1]-buffer_start[c]);
+	    const double * const cur_buffer = buffer + buffer_start[c] - block_start[c+1];
+	    for (int i=start; i<end && i<buffer_end; i++) y[i] += cur_buffer[i];
+	  }
+      }
+  }
+  return(0);
+}
@@ -0,0 +1,396 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Main routine of a program that checks every way HPC_sparsemv can run
+// against the plain loop over the rows of the double values.
+
+// Calling sequence:
+
+// test_sparsemv
+
+// The matrices are the generated 27-point stencil, a 7-point stencil,
+// symmetric ones with rows of 1 to 7 entries and few or many distinct
+// values, one whose rows reach more than 32767 columns away, and ones
+// made of dense 2x2, 3x3 and 4x4 blocks.  On each, y = Ax is computed
+// with every instruction set the processor supports, row widths 0, 7
+// and 27, double, float and coded values, and 32 and 16-bit indices,
+// and with the blocks and the upper triangle where the matrix has them.
+// With OpenMP every case is run on 1, 3 and the maximum number of
+// threads, with the static and a dynamic schedule.
+
+// An entry of y is wrong if it differs from the loop by more than 1e-12
+// times the sum of the magnitudes of its terms.  The float values are
+// compared against the loop over the rounded values.  The first wrong
+// entries are printed; the exit status is 1 if there are any.  Under
+// MPI each processor checks the matrices on its own.
+
+/////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+using std::cout;
+using std::endl;
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#ifdef USING_MPI
+#include <mpi.h>
+#include "make_local_matrix.hpp"
+#include "hpccg_comm.hpp"
+#endif
+#ifdef USING_OMP
+#include <omp.h>
+#endif
+#include "generate_matrix.hpp"
+#include "HPC_Sparse_Matrix.hpp"
+#include "HPC_sparsemv.hpp"
+#include "sparsemv_simd.hpp"
+#include "mixed_precision.hpp"
+#include "short_indices.hpp"
+#include "value_codes.hpp"
+#include "symmetric_matrix.hpp"
+#include "block_matrix.hpp"
+#include "tracked_memory.hpp"
+
+typedef std::vector<std::vector<std::pair<int,double> > > matrix_rows;
+
+// Wrong entries printed per case
+const int max_reported = 5;
+
+static int failures = 0;
+static int cases = 0;
+static int max_threads = 1;
+
+// Reproducible pseudo-random numbers in [0,1)
+static unsigned long long random_state = 12345;
+static double uniform()
+{
+  random_state = random_state*6364136223846793005ULL + 1442695040888963407ULL;
+  return((random_state>>11)*(1.0/9007199254740992.0));
+}
+
+// Builds a matrix from its rows the way the readers do
+static HPC_Sparse_Matrix * rows_matrix(const matrix_rows & rows)
+{
+  int nrow = rows.size(), nnz = 0;
+  for (int i=0; i<nrow; i++) nnz += rows[i].size();
+  HPC_Sparse_Matrix * A = new HPC_Sparse_Matrix;
+  initMatrix(A);
+  A->start_row = 0;
+  A->stop_row = nrow-1;
+  A->total_nrow = nrow;
+  A->total_nnz = nnz;
+  A->local_nrow = nrow;
+  A->local_ncol = nrow;
+  A->local_nnz = nnz;
+  A->nnz_in_row = tracked_new<int>(nrow, MEM_ROW_METADATA);
+  A->ptr_to_vals_in_row = tracked_new<double*>(nrow, MEM_ROW_METADATA);
+  A->ptr_to_inds_in_row = tracked_new<int*>(nrow, MEM_ROW_METADATA);
+  A->ptr_to_diags = tracked_new<double*>(nrow, MEM_ROW_METADATA);
+  A->list_of_vals = tracked_new<double>(nnz, MEM_VALUES);
+  A->list_of_inds = tracked_new<int>(nnz, MEM_INDICES);
+  double * vals = A->list_of_vals;
+  int * inds = A->list_of_inds;
+  for (int i=0; i<nrow; i++)
+    {
+      A->nnz_in_row[i] = rows[i].size();
+      A->ptr_to_vals_in_row[i] = vals;
+      A->ptr_to_inds_in_row[i] = inds;
+      A->ptr_to_diags[i] = 0;
+      for (size_t j=0; j<rows[i].size(); j++)
+	{
+	  if (rows[i][j].first==i) A->ptr_to_diags[i] = vals;
+	  *inds++ = rows[i][j].first;
+	  *vals++ = rows[i][j].second;
+	}
+    }
+  return(A);
+}
+
+// 7-point stencil on an nx by ny by nz grid
+static matrix_rows stencil_7(int nx, int ny, int nz)
+{
+  matrix_rows rows(nx*ny*nz);
+  for (int iz=0; iz<nz; iz++)
+    for (int iy=0; iy<ny; iy++)
+      for (int ix=0; ix<nx; ix++)
+	{
+	  int i = ix + nx*(iy + ny*iz);
+	  if (iz>0) rows[i].push_back(std::make_pair(i-nx*ny, -1.0));
+	  if (iy>0) rows[i].push_back(std::make_pair(i-nx, -1.0));
+	  if (ix>0) rows[i].push_back(std::make_pair(i-1, -1.0));
+	  rows[i].push_back(std::make_pair(i, 6.0));
+	  if (ix<nx-1) rows[i].push_back(std::make_pair(i+1, -1.0));
+	  if (iy<ny-1) rows[i].push_back(std::make_pair(i+nx, -1.0));
+	  if (iz<nz-1) rows[i].push_back(std::make_pair(i+nx*ny, -1.0));
+	}
+  return(rows);
+}
+
+// Symmetric, with a diagonal and up to 6 entries within reach of it in
+// each row.  The values are drawn from num_values of them, or are all
+// different if num_values is 0.  With far set, every 97th row is also
+// joined to the row 40000 after it.
+static matrix_rows random_rows(int nrow, int reach, int num_values, bool far)
+{
+  matrix_rows rows(nrow);
+  for (int i=0; i<nrow; i++) rows[i].push_back(std::make_pair(i, 10.0));
+  for (int i=0; i<nrow; i++)
+    {
+      int links = (int) (4.0*uniform());
+      for (int k=0; k<links; k++)
+	{
+	  int j = i + 1 + (int) (reach*uniform());
+	  if (far && i%97==0 && k==0) j = i + 40000;
+	  if (j>=nrow || rows[i].size()>=7 || rows[j].size()>=7) continue;
+	  bool dup = false;
+	  for (size_t l=0; l<rows[i].size(); l++) dup = dup || rows[i][l].first==j;
+	  if (dup) continue;
+	  double v = num_values ? -1.0 - (int) (num_values*uniform()) : uniform() - 1.0;
+	  rows[i].push_back(std::make_pair(j, v));
+	  rows[j].push_back(std::make_pair(i, v));
+	}
+    }
+  for (int i=0; i<nrow; i++) std::sort(rows[i].begin(), rows[i].end());
+  return(rows);
+}
+
+// Symmetric, of dense b by b blocks on a chain of nodes, each joined to
+// the nodes 1 and 3 before and after it
+static matrix_rows block_rows(int nnode, int b)
+{
+  matrix_rows rows(nnode*b);
+  const int offsets[] = {-3, -1, 0, 1, 3};
+  for (int I=0; I<nnode; I++)
+    for (int k=0; k<5; k++)
+      {
+	int J = I + offsets[k];
+	if (J<0 || J>=nnode) continue;
+	for (int r=0; r<b; r++)
+	  for (int c=0; c<b; c++)
+	    {
+	      int row = I*b+r, col = J*b+c;
+	      double v = row==col ? 20.0 : -1.0/(1.0 + row + col + 0.37*abs(row-col));
+	      rows[row].push_back(std::make_pair(col, v));
+	    }
+      }
+  return(rows);
+}
+
+// Compares y with the loop over the rows, on the float values if
+// float_vals is set
+static void check(HPC_Sparse_Matrix * A, const double * x, const double * y,
+		  bool float_vals, const char * matrix, const char * format)
+{
+  cases++;
+  int wrong = 0;
+  for (int i=0; i<A->local_nrow; i++)
+    {
+      double sum = 0.0, size = 0.0;
+      for (int j=0; j<A->nnz_in_row[i]; j++)
+	{
+	  double v = A->ptr_to_vals_in_row[i][j];
+	  if (float_vals) v = (float) v;
+	  double term = v*x[A->ptr_to_inds_in_row[i][j]];
+	  sum += term;
+	  size += fabs(term);
+	}
+      if (!(fabs(y[i]-sum)<=1.0e-12*size))
+	{
+	  if (wrong<max_reported)
+	    cout << "FAILED " << matrix << ", " << format << ": row " << i
+		 << " gives " << y[i] << ", expected " << sum << endl;
+	  wrong++;
+	}
+    }
+  if (wrong) failures++;
+}
+
+// Runs HPC_sparsemv on every format A has, for each thread count and
+// schedule
+static void check_matrix(HPC_Sparse_Matrix * A, const char * matrix)
+{
+#ifdef USING_MPI
+  make_local_matrix(A);
+#endif
+  sparsemv_setup(A);
+  make_float_values(A);
+  make_value_codes(A);
+  make_short_indices(A);
+  int block_size = make_block_matrix(A);
+  bool symmetric = make_symmetric_matrix(A);
+  float ** float_vals = A->ptr_to_float_vals_in_row;
+  unsigned char ** val_codes = A->ptr_to_val_codes_in_row;
+  short ** short_inds = A->ptr_to_short_inds_in_row;
+  int * block_row_start = A->block_row_start;
+  int * sym_row_start = A->sym_row_start;
+  A->block_row_start = 0;
+  A->sym_row_start = 0;
+
+  int nrow = A->local_nrow, short_rows = 0;
+  for (int i=0; short_inds && i<nrow; i++) if (short_inds[i]) short_rows++;
+  cout << matrix << ": " << nrow << " rows, row width " << A->row_width << ", "
+       << A->val_table_size << " distinct values, " << short_rows << " rows with 16-bit indices, "
+       << block_size << "x" << block_size << " blocks, "
+       << (symmetric ? "symmetric" : "not symmetric") << endl;
+
+  double * x = tracked_new_vector(A->local_ncol);
+  double * y = tracked_new_vector(nrow);
+  for (int i=0; i<A->local_ncol; i++) x[i] = 2.0*uniform() - 1.0;
+
+  std::vector<int> threads(1, 1);
+  if (max_threads>3) threads.push_back(3);
+  if (max_threads>1) threads.push_back(max_threads);
+  const int chunks[] = {0, 5};
+  const int widths[] = {0, 7, 27};
+  const char * const value_names[] = {"double", "float", "codes"};
+  char format[128];
+  for (size_t t=0; t<threads.size(); t++)
+    for (int c=0; c<2; c++)
+      {
+#ifdef USING_OMP
+	omp_set_num_threads(threads[t]);
+#endif
+	sparsemv_set_chunk(chunks[c]);
+	for (int isa=SIMD_SCALAR; isa<=simd_detect_isa(); isa++)
+	  {
+	    simd_select_isa(isa);
+	    for (int w=0; w<3; w++)
+	      for (int v=0; v<3; v++)
+		for (int s=0; s<2; s++)
+		  {
+		    if ((v==1 && !float_vals) || (v==2 && !val_codes) || (s==1 && !short_inds)) continue;
+		    A->row_width = widths[w];
+		    A->ptr_to_float_vals_in_row = v==1 ? float_vals : 0;
+		    A->ptr_to_val_codes_in_row = v==2 ? val_codes : 0;
+		    A->ptr_to_short_inds_in_row = s==1 ? short_inds : 0;
+		    for (int i=0; i<nrow; i++) y[i] = NAN;
+		    HPC_sparsemv(A, x, y);
+		    sprintf(format, "%s, row width %d, %s values, %d-bit indices, %d threads, chunk %d",
+			    simd_isa_names[isa], widths[w], value_names[v], s ? 16 : 32,
+			    threads[t], chunks[c]);
+		    check(A, x, y, v==1, matrix, format);
+		  }
+	    A->row_width = 0;
+	    A->ptr_to_float_vals_in_row = 0;
+	    A->ptr_to_val_codes_in_row = 0;
+	    A->ptr_to_short_inds_in_row = 0;
+	    if (block_row_start)
+	      {
+		A->block_row_start = block_row_start;
+		for (int i=0; i<nrow; i++) y[i] = NAN;
+		HPC_sparsemv(A, x, y);
+		A->block_row_start = 0;
+		sprintf(format, "%s, %dx%d blocks, %d threads, chunk %d", simd_isa_names[isa],
+			block_size, block_size, threads[t], chunks[c]);
+		check(A, x, y, false, matrix, format);
+	      }
+	  }
+	if (sym_row_start)
+	  {
+	    A->sym_row_start = sym_row_start;
+	    for (int i=0; i<nrow; i++) y[i] = NAN;
+	    HPC_sparsemv(A, x, y);
+	    A->sym_row_start = 0;
+	    sprintf(format, "symmetric, %d threads", threads[t]);
+	    check(A, x, y, false, matrix, format);
+	  }
+      }
+
+  A->ptr_to_float_vals_in_row = float_vals;
+  A->ptr_to_val_codes_in_row = val_codes;
+  A->ptr_to_short_inds_in_row = short_inds;
+  A->block_row_start = block_row_start;
+  A->sym_row_start = sym_row_start;
+  tracked_delete(x);
+  tracked_delete(y);
+  destroyMatrix(A);
+}
+
+int main(int argc, char *argv[])
+{
+#ifdef USING_MPI
+  MPI_Init(&argc, &argv);
+  hpccg_comm = MPI_COMM_SELF; // Each processor checks on its own
+#else
+  (void) argc; // Takes no arguments
+  (void) argv;
+#endif
+#ifdef USING_OMP
+  max_threads = omp_get_max_threads();
+#endif
+
+  HPC_Sparse_Matrix * A;
+  double * x, * b, * xexact;
+  generate_matrix(14, 13, 12, &A, &x, &b, &xexact);
+  tracked_delete(x);
+  tracked_delete(b);
+  tracked_delete(xexact);
+  check_matrix(A, "27-point stencil");
+  check_matrix(rows_matrix(stencil_7(13, 11, 9)), "7-point stencil");
+  check_matrix(rows_matrix(random_rows(1001, 40, 5, false)), "Short rows, 5 values");
+  check_matrix(rows_matrix(random_rows(1003, 1000, 0, false)), "Short rows, distinct values");
+  check_matrix(rows_matrix(random_rows(80000, 20, 3, true)), "Far columns");
+  for (int bs=min_block_size; bs<=max_block_size; bs++)
+    {
+      char name[32];
+      sprintf(name, "%dx%d blocks", bs, bs);
+      check_matrix(rows_matrix(block_rows(301, bs)), name);
+    }
+
+  int status = failures>0;
+#ifdef USING_MPI
+  int local_status = status;
+  MPI_Allreduce(&local_status, &status, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+#endif
+  cout << cases << " cases, " << failures << " failed" << endl;
+  if (status) cout << "FAILED" << endl;
+  else cout << "PASSED" << endl;
+#ifdef USING_MPI
+  MPI_Finalize();
+#endif
+  return(status);
+}
@@ -0,0 +1,220 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Routines for the per-iteration timing trace of HPCCG.
+
+// trace_init - Preallocates room for every timed call of max_iter
+//              iterations, so trace_record only stores a few values.
+
+// trace_statistics - For each kernel, min/median/p99/max over iterations
+//                    of the slowest rank's time, the worst iteration,
+//                    and the rank with the largest total time.  Must be
+//                    called by all processors.
+
+// trace_write_chrome - Writes the events of all processors to one file
+//                      in Chrome trace-event JSON format (load with
+//                      chrome://tracing or Perfetto).  Each rank appears
+//                      as a process.  Must be called by all processors.
+
+/////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+using std::cerr;
+using std::endl;
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include "trace.hpp"
+#include "hpccg_comm.hpp"
+
+const char * const trace_kernel_names[trace_num_kernels] =
+  {"DDOT", "WAXPBY", "SPARSEMV", "ALLREDUCE", "EXCHANGE"};
+
+// Timed calls per CG iteration, with room to spare
+const int trace_events_per_iteration = 12;
+
+void trace_init(HPCCG_Trace * trace, int max_iter)
+{
+  trace->max_iter = max_iter;
+  trace->max_events = max_iter*trace_events_per_iteration;
+  trace->num_events = 0;
+  trace->event_kernel = new int[trace->max_events];
+  trace->event_iteration = new int[trace->max_events];
+  trace->event_start = new double[trace->max_events];
+  trace->event_duration = new double[trace->max_events];
+  trace->iteration_time = new double[max_iter*trace_num_kernels];
+  for (int i=0; i<max_iter*trace_num_kernels; i++) trace->iteration_time[i] = 0.0;
+}
+
+void trace_destroy(HPCCG_Trace * trace)
+{
+  delete [] trace->event_kernel;
+  delete [] trace->event_iteration;
+  delete [] trace->event_start;
+  delete [] trace->event_duration;
+  delete [] trace->iteration_time;
+}
+
+void trace_statistics(HPCCG_Trace * trace, int num_iter,
+		      double stats[trace_num_kernels][trace_num_stats])
+{
+  int n = num_iter+1; // Iteration 0 is the initial residual
+  if (n>trace->max_iter) n = trace->max_iter;
+  int rank = 0;
+
+  std::vector<double> slowest(n*trace_num_kernels);
+#ifdef USING_MPI
+  MPI_Comm_rank(hpccg_comm, &rank);
+  MPI_Allreduce(trace->iteration_time, &slowest[0], n*trace_num_kernels,
+		MPI_DOUBLE, MPI_MAX, hpccg_comm);
+#else
+  for (int i=0; i<n*trace_num_kernels; i++) slowest[i] = trace->iteration_time[i];
+#endif
+
+  struct { double time; int rank; } total[trace_num_kernels], max_total[trace_num_kernels];
+  for (int kernel=0; kernel<trace_num_kernels; kernel++)
+    {
+      std::vector<double> times(n);
+      total[kernel].time = 0.0;
+      total[kernel].rank = rank;
+      int worst = 0;
+      for (int i=0; i<n; i++)
+	{
+	  times[i] = slowest[i*trace_num_kernels+kernel];
+	  if (times[i]>times[worst]) worst = i;
+	  total[kernel].time += trace->iteration_time[i*trace_num_kernels+kernel];
+	}
+      std::sort(times.begin(), times.end());
+      int p99 = (int) (0.99*n + 0.999999) - 1;
+      if (p99<0) p99 = 0;
+      stats[kernel][TRACE_MIN] = times[0];
+      stats[kernel][TRACE_MEDIAN] = (n%2) ? times[n/2] : 0.5*(times[n/2-1]+times[n/2]);
+      stats[kernel][TRACE_P99] = times[p99];
+      stats[kernel][TRACE_MAX] = times[n-1];
+      stats[kernel][TRACE_WORST_ITERATION] = worst;
+    }
+#ifdef USING_MPI
+  MPI_Allreduce(total, max_total, trace_num_kernels, MPI_DOUBLE_INT, MPI_MAXLOC, hpccg_comm);
+#else
+  for (int kernel=0; kernel<trace_num_kernels; kernel++) max_total[kernel] = total[kernel];
+#endif
+  for (int kernel=0; kernel<trace_num_kernels; kernel++)
+    {
+      stats[kernel][TRACE_SLOWEST_RANK] = max_total[kernel].rank;
+      stats[kernel][TRACE_SLOWEST_RANK_TIME] = max_total[kernel].time;
+    }
+}
+
+int trace_write_chrome(HPCCG_Trace * trace, const char * filename)
+{
+  int size = 1, rank = 0;
+#ifdef USING_MPI
+  MPI_Comm_size(hpccg_comm, &size);
+  MPI_Comm_rank(hpccg_comm, &rank);
+#endif
+
+  // Time stamps are relative to the earliest event on any processor
+  double local_origin = trace->num_events ? trace->event_start[0] : 0.0;
+  double origin = local_origin;
+#ifdef USING_MPI
+  MPI_Allreduce(&local_origin, &origin, 1, MPI_DOUBLE, MPI_MIN, hpccg_comm);
+#endif
+
+  std::vector<char> buf;
+  char line[256];
+  int len = sprintf(line, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+		    "\"args\":{\"name\":\"rank %d\"}}", rank, rank);
+  buf.insert(buf.end(), line, line+len);
+  for (int e=0; e<trace->num_events; e++)
+    {
+      len = sprintf(line, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":0,"
+		    "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"iteration\":%d}}",
+		    trace_kernel_names[trace->event_kernel[e]], rank,
+		    (trace->event_start[e]-origin)*1.0e6, trace->event_duration[e]*1.0e6,
+		    trace->event_iteration[e]);
+      buf.insert(buf.end(), line, line+len);
+    }
+
+  // Collect everything on processor 0, which writes the file
+  int local_len = buf.size();
+  std::vector<int> lengths(size, local_len), displs(size+1, 0);
+#ifdef USING_MPI
+  MPI_Gather(&local_len, 1, MPI_INT, &lengths[0], 1, MPI_INT, 0, hpccg_comm);
+#endif
+  for (int i=0; i<size; i++) displs[i+1] = displs[i] + lengths[i];
+  std::vector<char> all;
+  if (rank==0) all.resize(displs[size]);
+#ifdef USING_MPI
+  MPI_Gatherv(&buf[0], local_len, MPI_CHAR, rank==0 ? &all[0] : 0, &lengths[0], &displs[0],
+	      MPI_CHAR, 0, hpccg_comm);
+#else
+  all.swap(buf);
+#endif
+
+  int err = 0;
+  if (rank==0)
+    {
+      FILE * handle = fopen(filename, "w");
+      if (handle==0)
+	{
+	  cerr << "Error: Cannot open file: " << filename << endl;
+	  err = -1;
+	}
+      else
+	{
+	  fputs("[\n", handle);
+	  for (int i=0; i<size; i++)
+	    {
+	      if (i>0) fputs(",\n", handle);
+	      fwrite(&all[displs[i]], 1, lengths[i], handle);
+	    }
+	  fputs("\n]\n", handle);
+	  fclose(handle);
+	}
+    }
+#ifdef USING_MPI
+  MPI_Bcast(&err, 1, MPI_INT, 0, hpccg_comm);
+#endif
+  return(err);
+}
@@ -0,0 +1,105 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+#ifndef TRACE_H
+#define TRACE_H
+#ifdef USING_MPI
+#include <mpi.h>
+#endif
+
+// Kernels recorded in a trace
+enum { TRACE_DDOT, TRACE_WAXPBY, TRACE_SPARSEMV, TRACE_ALLREDUCE, TRACE_EXCHANGE,
+       trace_num_kernels };
+
+// Statistics computed by trace_statistics for each kernel.  The
+// distribution is over iterations, of the per-iteration time of the
+// slowest rank, since that is what the next collective waits for.
+enum { TRACE_MIN, TRACE_MEDIAN, TRACE_P99, TRACE_MAX, TRACE_WORST_ITERATION,
+       TRACE_SLOWEST_RANK, TRACE_SLOWEST_RANK_TIME, trace_num_stats };
+
+extern const char * const trace_kernel_names[trace_num_kernels];
+
+struct HPCCG_Trace_STRUCT {
+  int max_iter;        // Iterations 0 (initial residual) .. max_iter-1
+  int max_events;
+  int num_events;
+  int * event_kernel;  // Every timed call, for trace export
+  int * event_iteration;
+  double * event_start;
+  double * event_duration;
+  double * iteration_time; // [iteration*trace_num_kernels + kernel]
+};
+typedef struct HPCCG_Trace_STRUCT HPCCG_Trace;
+
+void trace_init(HPCCG_Trace * trace, int max_iter);
+void trace_destroy(HPCCG_Trace * trace);
+
+// Records one timed call.  Calls that include an MPI_Allreduce (ddot)
+// pass its duration as allreduce_time, which is recorded as a separate
+// event at the end of the call.
+inline void trace_record(HPCCG_Trace * trace, int iteration, int kernel,
+			 double start, double duration, double allreduce_time)
+{
+  int e = trace->num_events;
+  if (e+2 > trace->max_events || iteration>=trace->max_iter) return;
+  trace->event_kernel[e] = kernel;
+  trace->event_iteration[e] = iteration;
+  trace->event_start[e] = start;
+  trace->event_duration[e] = duration;
+  trace->iteration_time[iteration*trace_num_kernels+kernel] += duration;
+  e++;
+  if (allreduce_time>0.0)
+    {
+      trace->event_kernel[e] = TRACE_ALLREDUCE;
+      trace->event_iteration[e] = iteration;
+      trace->event_start[e] = start + duration - allreduce_time;
+      trace->event_duration[e] = allreduce_time;
+      trace->iteration_time[iteration*trace_num_kernels+TRACE_ALLREDUCE] += allreduce_time;
+      e++;
+    }
+  trace->num_events = e;
+}
+
+void trace_statistics(HPCCG_Trace * trace, int num_iter,
+		      double stats[trace_num_kernels][trace_num_stats]);
+int trace_write_chrome(HPCCG_Trace * trace, const char * filename);
+#endif
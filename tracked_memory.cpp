@@ -0,0 +1,409 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Routines to allocate memory that is counted by category, so the
+// footprint of a run can be reported.
+
+// tracked_alloc - Allocates bytes and counts them under category.  The
+//                 size and category are kept in a header in front of
+//                 the block, so tracked_free needs only the pointer.
+//                 Allocation happens outside of parallel regions, so
+//                 the counters are not protected.
+//                 Blocks of at least a huge page are mapped on
+//                 explicit 2 MB huge pages if the hugetlbfs pool has
+//                 them, otherwise on a 2 MB aligned region advised for
+//                 transparent huge pages; smaller blocks, and all blocks
+//                 after tracked_set_huge_pages(false), come from
+//                 posix_memalign.  Every block is tracked_alignment
+//                 aligned.
+
+// tracked_new_vector - Allocates and zeroes a vector in parallel, so on
+//                      a multi-socket node its pages are spread over the
+//                      sockets the same way the kernels' loops are.
+
+// memory_peak_rss - High-water mark of the resident set size, which also
+//                   includes untracked temporaries, MPI buffers, etc.
+
+// estimate_generated_memory - Bytes per processor a generated nx by ny
+//                             by nz sub-block on size processors will
+//                             need in each category, counting what
+//                             generate_matrix, make_local_matrix and
+//                             HPCCG allocate, without allocating it,
+//                             including the extra copies of the matrix
+//                             and vectors that options ask for.
+
+// auto_size_problem - Picks the largest cube that fits in bytes per
+//                     processor, then grows it one dimension at a time,
+//                     z first, while it still fits.  Sub-blocks must also
+//                     keep the halo within max_external and the global
+//                     row and nonzero counts within an int.
+
+/////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+using std::cerr;
+using std::endl;
+#include <cstdlib>
+#include <new>
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include "HPC_Sparse_Matrix.hpp"
+#include "tracked_memory.hpp"
+#ifdef USING_MPI
+#include "hpccg_comm.hpp"
+#endif
+
+const char * const mem_category_names[mem_num_categories] =
+  {"Matrix values", "Matrix indices", "Row metadata", "Vectors", "Comm buffers"};
+
+// Header in front of each block.  It takes tracked_alignment bytes, so
+// the block that follows is as aligned as the allocation.
+struct tracked_header {
+  void * base;     // Start of the malloc block or mapping
+  size_t length;   // Length of the mapping, 0 if from malloc
+  size_t bytes;
+  int category;
+  int pages;       // PAGES_* kind backing the block
+  int magic;
+};
+const int tracked_magic = 0x54524b44; // "TRKD"
+
+static long long current_bytes[mem_num_categories];
+static long long peak_bytes[mem_num_categories];
+static long long current_total = 0;
+static long long peak_total = 0;
+static long long page_bytes[page_num_kinds];
+static bool use_huge_pages = true;
+static int transparent_huge_pages = -1; // Unknown until the first large block
+
+const char * const page_kind_names[page_num_kinds] =
+  {"Base pages", "Transparent huge pages", "Explicit huge pages"};
+
+void tracked_set_huge_pages(bool enable)
+{
+  use_huge_pages = enable;
+}
+
+// THP can be used with madvise unless the kernel has it set to "never"
+static bool transparent_huge_pages_enabled()
+{
+  if (transparent_huge_pages<0)
+    {
+      transparent_huge_pages = 0;
+      FILE * f = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+      if (f)
+	{
+	  char line[128];
+	  if (fgets(line, sizeof(line), f) && strstr(line, "[never]")==0) transparent_huge_pages = 1;
+	  fclose(f);
+	}
+    }
+  return(transparent_huge_pages==1);
+}
+
+// Maps length bytes (a multiple of huge_page_size) for a large block,
+// trying explicit huge pages, then a huge page aligned region advised
+// for THP.  Returns 0 if nothing can be mapped.
+static char * map_large_block(size_t length, int & pages, void * & base, size_t & map_length)
+{
+#ifdef MAP_HUGETLB
+  void * p = mmap(0, length, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+  if (p!=MAP_FAILED)
+    {
+      pages = PAGES_EXPLICIT;
+      base = p;
+      map_length = length;
+      return((char *) p);
+    }
+#endif
+  // Over-map by a huge page and trim, so the region is huge page aligned
+  size_t over = length + huge_page_size;
+  char * q = (char *) mmap(0, over, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+  if (q==(char *) MAP_FAILED) return(0);
+  size_t head = (huge_page_size - ((size_t) q)%huge_page_size)%huge_page_size;
+  if (head>0) munmap(q, head);
+  if (over-head>length) munmap(q+head+length, over-head-length);
+  q += head;
+  pages = PAGES_BASE;
+#ifdef MADV_HUGEPAGE
+  if (transparent_huge_pages_enabled() && madvise(q, length, MADV_HUGEPAGE)==0)
+    pages = PAGES_TRANSPARENT;
+#endif
+  base = q;
+  map_length = length;
+  return(q);
+}
+
+void * tracked_alloc(size_t bytes, int category)
+{
+  char * block = 0;
+  void * base = 0;
+  size_t map_length = 0;
+  int pages = PAGES_BASE;
+  size_t total = tracked_alignment + bytes;
+  if (use_huge_pages && total>=huge_page_size)
+    {
+      size_t length = (total + huge_page_size - 1)/huge_page_size*huge_page_size;
+      block = map_large_block(length, pages, base, map_length);
+    }
+  if (block==0 && posix_memalign(&base, tracked_alignment, total)==0)
+    block = (char *) base;
+  if (block==0)
+    {
+      cerr << "Error: allocating " << bytes << " bytes of "
+	   << mem_category_names[category] << " failed, "
+	   << current_total << " bytes already allocated" << endl;
+      throw std::bad_alloc();
+    }
+  tracked_header * header = (tracked_header *) block;
+  header->base = base;
+  header->length = map_length;
+  header->bytes = bytes;
+  header->category = category;
+  header->pages = pages;
+  header->magic = tracked_magic;
+
+  current_bytes[category] += bytes;
+  if (current_bytes[category]>peak_bytes[category]) peak_bytes[category] = current_bytes[category];
+  current_total += bytes;
+  if (current_total>peak_total) peak_total = current_total;
+  page_bytes[pages] += bytes;
+  return(block + tracked_alignment);
+}
+
+void tracked_free(void * p)
+{
+  if (p==0) return;
+  tracked_header * header = (tracked_header *) ((char *) p - tracked_alignment);
+  if (header->magic!=tracked_magic)
+    {
+      cerr << "Error: tracked_free of memory not from tracked_alloc" << endl;
+      abort();
+    }
+  header->magic = 0;
+  current_bytes[header->category] -= header->bytes;
+  current_total -= header->bytes;
+  page_bytes[header->pages] -= header->bytes;
+  if (header->length>0)
+    munmap(header->base, header->length);
+  else
+    free(header->base);
+}
+
+long long memory_pages(int kind)
+{
+  return(page_bytes[kind]);
+}
+
+long long memory_transparent_huge_pages()
+{
+  FILE * f = fopen("/proc/self/smaps_rollup", "r");
+  if (f==0) return(-1);
+  long long kbytes = -1;
+  char line[256];
+  while (fgets(line, sizeof(line), f))
+    if (sscanf(line, "AnonHugePages: %lld kB", &kbytes)==1) break;
+  fclose(f);
+  return(kbytes<0 ? -1 : kbytes*1024);
+}
+
+double * tracked_new_vector(int n)
+{
+  double * v = tracked_new<double>(n, MEM_VECTORS);
+#ifdef USING_OMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int i=0; i<n; i++) v[i] = 0.0;
+  return(v);
+}
+
+long long memory_current(int category)
+{
+  return(current_bytes[category]);
+}
+
+long long memory_peak(int category)
+{
+  return(peak_bytes[category]);
+}
+
+long long memory_peak_total()
+{
+  return(peak_total);
+}
+
+long long memory_peak_rss()
+{
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage)) return(0);
+#ifdef __APPLE__
+  return((long long) usage.ru_maxrss);        // Bytes
+#else
+  return(((long long) usage.ru_maxrss)*1024); // Kilobytes
+#endif
+}
+
+void estimate_generated_memory(int nx, int ny, int nz, int size, const HPCCG_Options & options,
+			       long long bytes[mem_num_categories])
+{
+  long long nrow = ((long long) nx)*ny*nz;
+  long long nnz = 27*nrow; // What generate_matrix allocates
+  long long num_external = 0;
+  // Sub-blocks are stacked in z: one xy plane from each neighbor below
+  // and above, and as many rows are sent as received
+  if (size>1) num_external = 2*((long long) nx)*ny;
+  long long ncol = nrow + num_external;
+
+  bytes[MEM_VALUES] = sizeof(double)*nnz;
+  bytes[MEM_INDICES] = sizeof(int)*nnz;
+  bytes[MEM_ROW_METADATA] = (sizeof(int) + sizeof(double *) + sizeof(int *) + sizeof(double *))*nrow;
+  bytes[MEM_VECTORS] = sizeof(double)*(3*nrow + 2*nrow + ncol); // x, b, xexact; r, Ap, p
+  if (options.float_values) // Float copy (make_float_values), x of the comparison solve
+    {
+      bytes[MEM_VALUES] += sizeof(float)*nnz;
+      bytes[MEM_ROW_METADATA] += sizeof(float *)*nrow;
+      bytes[MEM_VECTORS] += sizeof(double)*nrow;
+    }
+  if (options.refine) bytes[MEM_VECTORS] += sizeof(double)*2*nrow; // r, d of HPCCG_refine
+  if (options.short_indices) // 16-bit copy (make_short_indices), padded
+    {
+      bytes[MEM_INDICES] += sizeof(short)*(nnz + short_index_padding);
+      bytes[MEM_ROW_METADATA] += sizeof(short *)*nrow;
+    }
+  if (options.symmetric) // Upper triangle (make_symmetric_matrix), buffers not counted
+    {
+      // Half the local off-diagonal entries, all of the external ones
+      long long num_external_nnz = 9*num_external;
+      long long sym_nnz = (nnz - nrow - num_external_nnz)/2 + num_external_nnz;
+      bytes[MEM_VALUES] += sizeof(double)*(sym_nnz + nrow);
+      bytes[MEM_INDICES] += sizeof(int)*sym_nnz;
+      bytes[MEM_ROW_METADATA] += sizeof(int)*(2*nrow + 1);
+    }
+  // bcsr adds nothing: the stencils have no dense blocks, so
+  // make_block_matrix keeps the rows
+  if (options.value_codes) // Codes and table (make_value_codes), padded
+    {
+      bytes[MEM_VALUES] += nnz + value_code_padding + sizeof(double)*max_value_codes;
+      bytes[MEM_ROW_METADATA] += sizeof(unsigned char *)*nrow;
+    }
+  bytes[MEM_COMM_BUFFERS] = 0;
+  if (size>1)
+    bytes[MEM_COMM_BUFFERS] = 3*sizeof(int)*(long long) max_external // external indices, receive list
+      + 3*sizeof(int)*(long long) max_num_neighbors                 // neighbors and lengths
+      + (sizeof(int) + sizeof(double))*num_external;                // elements to send, send buffer
+}
+
+long long node_memory_per_rank()
+{
+  // Available memory, which leaves out what other jobs on a shared node
+  // already use but counts the page cache they can be given back.  Kernels
+  // without MemAvailable only report the free pages.
+  long long bytes = 0;
+  FILE * f = fopen("/proc/meminfo", "r");
+  if (f!=0)
+    {
+      long long kbytes = -1;
+      char line[256];
+      while (fgets(line, sizeof(line), f))
+	if (sscanf(line, "MemAvailable: %lld kB", &kbytes)==1) break;
+      fclose(f);
+      if (kbytes>0) bytes = kbytes*1024;
+    }
+  if (bytes==0)
+    {
+      long long pages = sysconf(_SC_AVPHYS_PAGES);
+      long long page_size = sysconf(_SC_PAGE_SIZE);
+      if (pages>0 && page_size>0) bytes = pages*page_size;
+    }
+#ifdef USING_MPI
+  // Processors sharing this node split its memory
+  MPI_Comm node_comm;
+  int ranks_on_node;
+  MPI_Comm_split_type(hpccg_comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node_comm);
+  MPI_Comm_size(node_comm, &ranks_on_node);
+  MPI_Comm_free(&node_comm);
+  bytes /= ranks_on_node;
+  if (bytes==0) bytes = LLONG_MAX; // Unknown here, let the others decide
+  long long min_bytes;
+  MPI_Allreduce(&bytes, &min_bytes, 1, MPI_LONG_LONG, MPI_MIN, hpccg_comm);
+  bytes = min_bytes==LLONG_MAX ? 0 : min_bytes;
+#endif
+  return(bytes);
+}
+
+static bool sub_block_fits(long long bytes, int size, const HPCCG_Options & options,
+			   int nx, int ny, int nz)
+{
+  long long nrow = ((long long) nx)*ny*nz;
+  if (27*nrow*size>INT_MAX) return(false);
+  if (size>1 && 2*((long long) nx)*ny>max_external) return(false);
+  long long estimate[mem_num_categories];
+  estimate_generated_memory(nx, ny, nz, size, options, estimate);
+  long long total = 0;
+  for (int c=0; c<mem_num_categories; c++) total += estimate[c];
+  return(total<=bytes);
+}
+
+bool auto_size_problem(long long bytes, int size, const HPCCG_Options & options,
+		       int & nx, int & ny, int & nz)
+{
+  int n = 0;
+  while (sub_block_fits(bytes, size, options, n+1, n+1, n+1)) n++;
+  if (n==0) return(false);
+  nx = ny = nz = n;
+
+  bool grown = true;
+  while (grown)
+    {
+      grown = false;
+      if (sub_block_fits(bytes, size, options, nx, ny, nz+1)) { nz++; grown = true; }
+      if (sub_block_fits(bytes, size, options, nx, ny+1, nz)) { ny++; grown = true; }
+      if (sub_block_fits(bytes, size, options, nx+1, ny, nz)) { nx++; grown = true; }
+    }
+  return(true);
+}
@@ -0,0 +1,123 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+#ifndef TRACKED_MEMORY_H
+#define TRACKED_MEMORY_H
+#include <cstddef>
+#include "parse_options.hpp"
+
+// Categories that tracked allocations are counted under
+enum { MEM_VALUES, MEM_INDICES, MEM_ROW_METADATA, MEM_VECTORS, MEM_COMM_BUFFERS,
+       mem_num_categories };
+
+extern const char * const mem_category_names[mem_num_categories];
+
+// Pages that can back a block
+enum { PAGES_BASE, PAGES_TRANSPARENT, PAGES_EXPLICIT, page_num_kinds };
+
+extern const char * const page_kind_names[page_num_kinds];
+
+// Blocks are aligned for the widest SIMD loads and a cache line
+const size_t tracked_alignment = 64;
+const size_t huge_page_size = 2*1024*1024;
+
+// Huge pages are used for large blocks unless disabled, before allocating
+void tracked_set_huge_pages(bool enable);
+
+void * tracked_alloc(size_t bytes, int category);
+void tracked_free(void * p);
+
+// Typed forms: tracked_new<double>(n, MEM_VECTORS) in place of
+// new double[n], and tracked_delete(p) in place of delete [] p.  Only
+// for types that need no constructor or destructor.
+template <class T> inline T * tracked_new(size_t n, int category)
+{
+  return((T *) tracked_alloc(n*sizeof(T), category));
+}
+template <class T> inline void tracked_delete(T * p)
+{
+  tracked_free((void *) p);
+}
+
+// A page is placed near the thread that first writes it.  So the
+// vectors, and each copy of the matrix, are first written in parallel
+// with the static OpenMP row partition the kernels use, which puts each
+// page near the thread that will read it.
+
+// Allocates n doubles under MEM_VECTORS and zeroes them in parallel
+double * tracked_new_vector(int n);
+
+// Bytes currently allocated and high-water marks, per category and in
+// total, on this processor.
+long long memory_current(int category);
+long long memory_peak(int category);
+long long memory_peak_total();
+
+// Peak resident set size of this process in bytes, 0 if unknown
+long long memory_peak_rss();
+
+// Bytes currently allocated on each kind of page, and the bytes the
+// kernel has actually backed with transparent huge pages (from
+// /proc/self/smaps_rollup), -1 if unknown
+long long memory_pages(int kind);
+long long memory_transparent_huge_pages();
+
+// Sizes of the optional matrix copies that the estimate counts, kept
+// here so the allocator does not depend on the formats.  The 16-bit
+// indices and the value codes have this many entries after the last
+// row, so the vector kernels can load a full register at the end of any
+// row, and a value table holds at most max_value_codes values.
+const int short_index_padding = 8;
+const int value_code_padding = 8;
+const int max_value_codes = 256;
+
+void estimate_generated_memory(int nx, int ny, int nz, int size, const HPCCG_Options & options,
+			       long long bytes[mem_num_categories]);
+
+// Available memory of the node divided among the processors on it, the
+// smallest such share over all processors, 0 if unknown.  Collective.
+long long node_memory_per_rank();
+
+// Largest generated sub-block whose estimate fits in bytes per processor
+bool auto_size_problem(long long bytes, int size, const HPCCG_Options & options,
+		       int & nx, int & ny, int & nz);
+#endif
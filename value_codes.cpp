@@ -0,0 +1,152 @@
+
+//@HEADER
+// ************************************************************************
+// 
+//               HPCCG: Simple Conjugate Gradient Benchmark Code
+//                 Copyright (2006) Sandia Corporation
+// 
+// Under terms of Contract DE-AC04-94AL85000, there is a non-exclusive
+// license for use of this work by or on behalf of the U.S. Government.
+// 
+// BSD 3-Clause License
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+// 
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// 
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Questions? Contact Michael A. Heroux (maherou@sandia.gov) 
+// 
+// ************************************************************************
+//@HEADER
+
+/////////////////////////////////////////////////////////////////////////
+
+// Routine to compress the values of a matrix for HPC_sparsemv.
+
+// The generated matrix has two distinct values, 27 and -1, and many
+// finite element matrices have few more.  If there are at most
+// max_value_codes on this processor, each value is replaced by a 1-byte
+// code into a table of the distinct values, which stays in the first
+// level cache; the kernels read one byte per nonzero instead of eight
+// and look the value up.  The table holds the values exactly, so the
+// products are the same as with the double values, which are kept for
+// the rest of the code.
+
+// Values are compared by their bits, so e.g. 0.0 and -0.0 get codes of
+// their own.  The table is sorted by bits and the codes are found by
+// binary search, remembering the last value as most neighbors repeat
+// it.  The codes are written row by row in parallel (see first touch
+// in tracked_memory.hpp).
+
+/////////////////////////////////////////////////////////////////////////
+
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include "value_codes.hpp"
+#include "tracked_memory.hpp"
+
+static inline unsigned long long value_bits(double value)
+{
+  unsigned long long bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return(bits);
+}
+
+int make_value_codes(HPC_Sparse_Matrix * A)
+{
+  const int nrow = A->local_nrow;
+  if (A->list_of_val_codes) tracked_delete(A->list_of_val_codes);
+  if (A->ptr_to_val_codes_in_row) tracked_delete(A->ptr_to_val_codes_in_row);
+  if (A->val_table) tracked_delete(A->val_table);
+  A->list_of_val_codes = 0;
+  A->ptr_to_val_codes_in_row = 0;
+  A->val_table = 0;
+  A->val_table_size = 0;
+
+  // Distinct values, sorted by their bits
+  std::vector<unsigned long long> keys;
+  long long nnz = 0;
+  bool have_last = false;
+  unsigned long long last = 0;
+  for (int i=0; i<nrow; i++)
+    {
+      const double * const cur_vals = A->ptr_to_vals_in_row[i];
+      for (int j=0; j<A->nnz_in_row[i]; j++)
+	{
+	  unsigned long long bits = value_bits(cur_vals[j]);
+	  if (have_last && bits==last) continue;
+	  have_last = true;
+	  last = bits;
+	  std::vector<unsigned long long>::iterator pos =
+	    std::lower_bound(keys.begin(), keys.end(), bits);
+	  if (pos!=keys.end() && *pos==bits) continue;
+	  if ((int) keys.size()==max_value_codes) return(0);
+	  keys.insert(pos, bits);
+	}
+      nnz += A->nnz_in_row[i];
+    }
+  const int num_values = keys.size();
+  if (num_values==0) return(0);
+
+  double * val_table = tracked_new<double>(num_values, MEM_VALUES);
+  for (int k=0; k<num_values; k++) memcpy(&val_table[k], &keys[k], sizeof(double));
+
+  std::vector<long long> offsets(nrow);
+  long long offset = 0;
+  for (int i=0; i<nrow; i++)
+    {
+      offsets[i] = offset;
+      offset += A->nnz_in_row[i];
+    }
+
+  unsigned char * list_of_val_codes = tracked_new<unsigned char>(nnz + value_code_padding, MEM_VALUES);
+  unsigned char ** ptr_to_val_codes_in_row = tracked_new<unsigned char*>(nrow, MEM_ROW_METADATA);
+#ifdef USING_OMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int i=0; i<nrow; i++)
+    {
+      const double * const cur_vals = A->ptr_to_vals_in_row[i];
+      unsigned char * const cur_codes = list_of_val_codes + offsets[i];
+      unsigned long long last_bits = 0;
+      int code = -1;
+      for (int j=0; j<A->nnz_in_row[i]; j++)
+	{
+	  unsigned long long bits = value_bits(cur_vals[j]);
+	  if (code<0 || bits!=last_bits)
+	    code = std::lower_bound(keys.begin(), keys.end(), bits) - keys.begin();
+	  last_bits = bits;
+	  cur_codes[j] = (unsigned char) code;
+	}
+      ptr_to_val_codes_in_row[i] = cur_codes;
+    }
+  for (int j=0; j<value_code_padding; j++) list_of_val_codes[nnz+j] = 0;
+
+  A->list_of_val_codes = list_of_val_codes;
+  A->ptr_to_val_codes_in_row = ptr_to_val_codes_in_row;
+  A->val_table = val_table;
+  A->val_table_size = num_values;
+  return(num_values);
+}